@@ -7,12 +7,30 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <cmath>
 #include <cstdint>
+#include <iterator>
 #include <limits>
+#include <numeric>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+// Floating point results must be the same on every platform, so a * b + c
+// must not be contracted into a fused multiply-add where the target has one.
+#if defined(__clang__)
+#pragma float_control(push)
+#pragma clang fp contract(off)
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+#endif
+
 namespace random_private {
 
 using std::array, std::uint8_t, std::uint32_t, std::uint64_t, std::int64_t;
@@ -28,14 +46,213 @@ constexpr array<uint32_t, 8> key = {
     0x7391688F, 0x3BE114E4, 0x07DFCCA9, 0x5053BCBC,
 };
 
+// Number of ChaCha blocks computed at once, one per SIMD lane.
+constexpr int num_parallel_blocks = 4;
+
+constexpr int word_buffer_size = 16 * num_parallel_blocks;
+
+class Random;
+class SortedSample;
+
+// Deterministic primality test for all 64-bit n.
+//
+// Trial division by small primes, then Miller-Rabin with the 7 bases of
+// Jim Sinclair, using Montgomery multiplication.
+bool is_prime(uint64_t n);
+
+// out[i] = is_prime(begin[i]). Faster than separate calls: Miller-Rabin
+// runs on 4 numbers at a time so that their multiplications overlap.
+template <typename Iter, typename OutIter>
+void is_prime(Iter begin, Iter end, OutIter out);
+
+// Arithmetic modulo an odd n > 1 in Montgomery form: x is represented by
+// x 2^64 mod n.
+class Montgomery64 {
+public:
+    explicit Montgomery64(uint64_t n);
+
+    uint64_t modulus() const { return m_n; }
+    uint64_t to_montgomery(uint64_t x) const;
+    uint64_t from_montgomery(uint64_t x) const { return reduce(x); }
+    uint64_t one() const { return m_one; }
+    uint64_t multiply(uint64_t a, uint64_t b) const {
+        return reduce(static_cast<unsigned __int128>(a) * b);
+    }
+
+private:
+    // t 2^-64 mod n, for t < n 2^64.
+    uint64_t reduce(unsigned __int128 t) const;
+
+    uint64_t m_n;
+    // -n^-1 mod 2^64.
+    uint64_t m_neg_inverse;
+    // 2^64 mod n.
+    uint64_t m_one;
+};
+
+// Set of uint64_t. Open addressing with linear probing.
+class HashSet64 {
+public:
+    explicit HashSet64(size_t expected_size = 0);
+
+    // Returns false if x was already present.
+    bool insert(uint64_t x);
+    // Returns false if x was not present.
+    bool erase(uint64_t x);
+    bool contains(uint64_t x) const;
+    size_t size() const { return m_size; }
+
+private:
+    // Marks empty slots. Membership of empty_key itself is stored separately.
+    static constexpr uint64_t empty_key = ~uint64_t{0};
+
+    // Fibonacci hashing.
+    size_t slot(const uint64_t x) const {
+        return static_cast<size_t>((x * 0x9E3779B97F4A7C15u) >> m_shift);
+    }
+    void grow();
+
+    std::vector<uint64_t> m_slots;
+    int m_shift;
+    size_t m_size = 0;
+    bool m_contains_empty_key = false;
+};
+
+// Uniform integers from [min, max].
+//
+// Precomputes everything that depends only on the range, so that
+// Random::sample does no division.
+template <typename T>
+class UniformIntDistribution {
+public:
+    UniformIntDistribution(T min, T max);
+
+    T min() const { return m_min; }
+    T max() const { return m_max; }
+
+private:
+    friend class Random;
+
+    T m_min;
+    T m_max;
+    // max - min + 1, or 0 for the full 64-bit range.
+    uint64_t m_n;
+    // Multiply-shift rejects when the low half of the product is below this.
+    uint64_t m_threshold;
+};
+
+// Generator returned by Random::sorted_sample.
+//
+// Vitter, An Efficient Algorithm for Sequential Random Sampling.
+// Algorithm D, switching to Algorithm A when k is a large fraction of n.
+class SortedSample {
+public:
+    SortedSample(Random &random, uint64_t k, uint64_t n);
+
+    // Number of values not yet generated.
+    uint64_t remaining() const { return m_remaining; }
+
+    // The next value. remaining() > 0
+    uint64_t next();
+
+private:
+    uint64_t skip_a();
+    uint64_t skip_d();
+    double uniform();
+
+    Random &m_random;
+    uint64_t m_remaining;
+    // Values before m_position are done with.
+    uint64_t m_position = 0;
+    // Number of values not yet done with.
+    uint64_t m_population;
+    bool m_use_a;
+    // Algorithm D: U^(1/m_remaining), carried from one step to the next.
+    double m_v_prime = 0.0;
+};
+
+// Strings stored contiguously: string i is
+// bytes[offsets[i], offsets[i+1]).
+struct StringTable {
+    std::vector<size_t> offsets = {0};
+    std::string bytes;
+
+    size_t size() const { return offsets.size() - 1u; }
+
+    std::string_view operator[](const size_t i) const {
+        return std::string_view(bytes).substr(offsets[i], offsets[i + 1] - offsets[i]);
+    }
+};
+
+// Random index i from [0, n) with probability proportional to weight[i].
+//
+// Vose's alias method: O(n) construction, O(1) per sample. Integer weights
+// are exact. Real weights are converted to double and scaled to integers
+// summing to about 2^62, in double arithmetic.
+class DiscreteDistribution {
+public:
+    // Weights are non-negative, not all zero.
+    // 1 <= n < 2^32, sum of integer weights < 2^64.
+    template <typename Iter>
+    DiscreteDistribution(Iter begin, Iter end);
+
+    size_t size() const { return m_alias.size(); }
+
+private:
+    friend class Random;
+
+    void build(const std::vector<uint64_t> &weights);
+
+    // Column i is chosen uniformly, then a uniform level in the column.
+    // Levels below m_threshold[i] give i, others give m_alias[i].
+    UniformIntDistribution<uint32_t> m_column{0, 0};
+    UniformIntDistribution<uint64_t> m_level{0, 0};
+    std::vector<uint64_t> m_threshold;
+    std::vector<uint32_t> m_alias;
+};
+
 // A random generator.
 class Random {
 public:
-    // Random stream is determined by (key, problem_name, test_id).
+    // How ChaCha words are turned into bits.
+    //
+    // Different versions generate different streams. Old test data can be
+    // regenerated by passing the version it was created with.
+    enum class Version {
+        // 32-bit bit buffer.
+        v1,
+        // 64-bit bit buffer, bits consumed from the low end of each word.
+        v2,
+    };
+
+    // Algorithm used for bounded integers by uniform_int etc.
+    enum class UniformMethod {
+        // Keeps leftover entropy between calls, so uses few random bits,
+        // but needs 64-bit divisions.
+        buffered,
+        // Lemire's multiply-shift. One word per value, no division except
+        // in rare cases.
+        multiply_shift,
+    };
+
+    // Which endpoints a real interval includes.
+    enum class Interval {
+        // [min, max]
+        closed,
+        // [min, max)
+        closed_open,
+        // (min, max]
+        open_closed,
+        // (min, max)
+        open,
+    };
+
+    // Random stream is determined by (key, problem_name, test_id, version).
     //
     // problem_name.size() <= 4
     explicit Random(const std::string_view problem_name,
-                    uint32_t test_id);
+                    uint32_t test_id,
+                    Version version = Version::v2);
 
     // Move only.
     Random(const Random &) = delete;
@@ -43,40 +260,224 @@ public:
     Random(Random &&) = default;
     Random &operator=(Random &&) = default;
 
+    // Changes the stream of uniform_int etc.
+    void set_uniform_method(UniformMethod method);
+
+    // An independent generator, keyed by 256 bits from this stream.
+    // Same version and uniform method.
+    Random substream();
+
+    // 0 <= n <= 64
     uint64_t bits(int n);
 
     int uniform_int(int min, int max);
     unsigned uniform_uint(unsigned min, unsigned max);
     int64_t uniform_int64(int64_t min, int64_t max);
     uint64_t uniform_uint64(uint64_t min, uint64_t max);
+    unsigned __int128 uniform_uint128(unsigned __int128 min, unsigned __int128 max);
+    __int128 uniform_int128(__int128 min, __int128 max);
+
+    // Uniform integer from [min, max] in decimal, for bounds beyond 64 bits.
+    // min and max are non-negative, without leading zeros.
+    //
+    // The digits of the offset from min are generated directly into the
+    // result, most significant first, rejecting early when the prefix
+    // exceeds max - min. O(number of digits) expected.
+    std::string uniform_decimal(std::string_view min, std::string_view max);
+
+    // Fill [begin, end) with independent uniform values from [min, max].
+    //
+    // Much faster than calling uniform_int repeatedly: values are generated
+    // directly from ChaCha words by multiply-shift with rejection. ChaCha20
+    // itself is the limit: on one x86-64 core this fills about 0.45 GB/s at
+    // -O2 and 0.75 GB/s with -O3 -march=native.
+    template <typename Iter, typename T>
+    void uniform_ints(Iter begin, Iter end, T min, T max);
+
+    // Uniform real from the interval. T is float, double or long double.
+    //
+    // All mantissa bits are random: the result is min * (1 - u) + max * u
+    // for u on a grid of 2^digits points in [0, 1].
+    template <typename T>
+    T uniform_real(T min, T max, Interval interval = Interval::closed_open);
+
+    // Fill [begin, end) with independent uniformly random characters from
+    // alphabet.
+    //
+    // Several characters are extracted from each 32-bit word: bit slicing
+    // for power-of-two alphabet sizes, base-k digits of a multiply-shift
+    // sample otherwise. Iter must be random access.
+    template <typename Iter>
+    void fill_string(Iter begin, Iter end, std::string_view alphabet);
+
+    // Uniformly random balanced bracket sequence (Dyck word) in [begin, end).
+    // The length must be even.
+    //
+    // Cycle lemma: a random arrangement of n open and n+1 close brackets
+    // has exactly one rotation that is a Dyck word followed by a close
+    // bracket. O(n), writing only to [begin, end). Iter must be random
+    // access.
+    template <typename Iter>
+    void balanced_brackets(Iter begin, Iter end, char open = '(', char close = ')');
+
+    // Distinct strings over alphabet with the given lengths, all such
+    // sequences equally likely.
+    //
+    // Each string is generated by fill_string and regenerated while it
+    // duplicates an earlier one, found with a hash set of indices into the
+    // table. Slow if some length has few more possible strings than
+    // requested.
+    StringTable distinct_strings(const std::vector<size_t> &lengths,
+                                 std::string_view alphabet);
+
+    // Fill [begin, end) with independent uniform_real values.
+    template <typename Iter, typename T>
+    void uniform_reals(Iter begin, Iter end, T min, T max,
+                       Interval interval = Interval::closed_open);
+
+    // Normal distribution. stddev >= 0
+    double normal(double mean, double stddev);
+
+    // Exponential distribution with rate lambda > 0.
+    double exponential(double lambda);
+
+    // Number of successes in n independent trials with probability p.
+    uint64_t binomial(uint64_t n, double p);
+
+    // Poisson distribution with mean lambda >= 0.
+    uint64_t poisson(double lambda);
+
+    // Number of failures before the first success, each trial succeeding
+    // with probability p, 0 < p <= 1. Saturates at 2^64 - 1.
+    uint64_t geometric(double p);
+
+    template <typename T>
+    T sample(const UniformIntDistribution<T> &distribution);
+
+    size_t sample(const DiscreteDistribution &distribution);
 
     template <typename Iter>
     void shuffle(Iter begin, Iter end);
 
+    // Uniformly random permutation of [begin, end), for huge ranges.
+    //
+    // MergeShuffle: blocks that fit in cache are shuffled independently,
+    // then merged pairwise. Each block and each merge uses its own
+    // substream, so the result doesn't depend on num_threads.
+    // num_threads = 0 means hardware concurrency.
+    template <typename Iter>
+    void parallel_shuffle(Iter begin, Iter end, unsigned num_threads = 0);
+
+    // Uniformly random permutations of [0, n) with constraints.
+    // p[i] is the image of i.
+
+    // No fixed points. n != 1. O(n) expected time.
+    std::vector<int> derangement(int n);
+
+    // A single n-cycle. O(n).
+    std::vector<int> cyclic_permutation(int n);
+
+    // p[p[i]] = i. O(n).
+    std::vector<int> involution(int n);
+
+    // Exactly k cycles, 1 <= k <= n, or n = k = 0.
+    //
+    // Cycle-start indicators are drawn under the Ewens distribution tuned
+    // so that k cycles is the mean, and conditioned on exactly k by
+    // rejection. Most starts are a binomial count of uniformly random
+    // elements, so few attempts are needed. Expected time O(n log n).
+    std::vector<int> permutation_with_cycles(int n, int k);
+
+    // k distinct values from [min, max], all k-subsets equally likely.
+    //
+    // Unsorted output is in uniformly random order. Sorted output comes
+    // from sorted_sample, or a bitmap when the range is dense.
+    // Time and memory O(k) regardless of the size of the range, except
+    // O(k log k) time for sorted output over the full 64-bit range.
+    template <typename T>
+    std::vector<T> sample_distinct(size_t k, T min, T max, bool sorted = false);
+
+    // Uniformly random k-subset of [0, n), generated in increasing order.
+    // O(k) time, O(1) memory. Don't use this Random while the generator
+    // is in use.
+    SortedSample sorted_sample(uint64_t k, uint64_t n);
+
+    // k parts >= min_part with the given total, all such compositions
+    // equally likely. O(k): the k-1 bars are generated in increasing order
+    // by sorted_sample.
+    template <typename T>
+    std::vector<T> composition(T total, size_t k, T min_part = 1);
+
+    // Uniformly random partition of n into positive parts, in
+    // non-increasing order.
+    //
+    // Arratia, DeSalvo. Probabilistic divide-and-conquer: Boltzmann
+    // sampling of the multiplicities of parts 2, ..., n, then the
+    // multiplicity of 1 is accepted with the right probability. Expected
+    // O(n^(1/4)) attempts of O(sqrt(n)) each.
+    std::vector<uint64_t> integer_partition(uint64_t n);
+
+    // Uniformly random prime in [min, max]. Throws std::invalid_argument
+    // if there is none.
+    uint64_t prime(uint64_t min, uint64_t max);
+
+    // Uniformly random pair from [min, max]^2 with gcd 1.
+    std::pair<uint64_t, uint64_t> coprime_pair(uint64_t min, uint64_t max);
+
+    // Uniformly random k-tuple from [min, max]^k whose gcd is 1. The
+    // elements need not be pairwise coprime.
+    std::vector<uint64_t> coprime_tuple(size_t k, uint64_t min, uint64_t max);
+
 private:
+    friend class SortedSample;
+
+    Random(const array<uint32_t, 8> &key, Version version);
+
+    void refill_words();
+    uint32_t next_word32();
+    uint64_t next_word64();
+    uint64_t bits_v1(int n);
+    uint64_t uniform_buffered(uint64_t n);
+    uint64_t uniform_multiply_shift(uint64_t n);
+    template <typename T>
+    T unit_real(Interval interval);
+    template <typename T>
+    T uniform_real_unchecked(T min, T max, Interval interval);
+    double standard_normal();
+    double standard_exponential();
+
+    Version m_version;
+    array<uint32_t, 8> m_key = key;
     uint64_t m_nonce;
     uint64_t m_counter = 0;
-    array<uint32_t, 16> m_word_buffer = {};
-    int m_word_buffer_next = 16;
+    array<uint32_t, word_buffer_size> m_word_buffer = {};
+    int m_word_buffer_next = word_buffer_size;
 
-    uint32_t m_bits_buffer = 0;
+    // The low m_num_bits bits are valid.
+    uint64_t m_bits_buffer = 0;
     int m_num_bits = 0;
 
+    UniformMethod m_uniform_method = UniformMethod::buffered;
     uint64_t m_number_buffer = 0;
     uint64_t m_number_range = 1;
 };
 
-template <int bits>
-inline uint32_t rotate_left(const uint32_t x) {
+// Four 32-bit SIMD lanes.
+typedef uint32_t uint32x4 __attribute__((vector_size(16)));
+
+// T is uint32_t or uint32x4.
+template <int bits, typename T>
+inline T rotate_left(const T x) {
     static_assert(bits > 0 && bits < 32);
     return (x << bits) | (x >> (32 - bits));
 }
 
+template <typename T>
 inline void quarter_round(
-        uint32_t &a,
-        uint32_t &b,
-        uint32_t &c,
-        uint32_t &d)
+        T &a,
+        T &b,
+        T &c,
+        T &d)
 {
     a += b;
     d ^= a;
@@ -92,14 +493,37 @@ inline void quarter_round(
     b = rotate_left<7>(b);
 }
 
+template <int rounds, typename T>
+array<T, 16> chacha_rounds(const array<T, 16> &input) {
+    static_assert(rounds == 8 || rounds == 12 || rounds == 20);
+
+    array<T, 16> x = input;
+
+    for (int double_round = 0; double_round < rounds / 2; ++double_round) {
+        quarter_round(x[0], x[4], x[8], x[12]);
+        quarter_round(x[1], x[5], x[9], x[13]);
+        quarter_round(x[2], x[6], x[10], x[14]);
+        quarter_round(x[3], x[7], x[11], x[15]);
+
+        quarter_round(x[0], x[5], x[10], x[15]);
+        quarter_round(x[1], x[6], x[11], x[12]);
+        quarter_round(x[2], x[7], x[8], x[13]);
+        quarter_round(x[3], x[4], x[9], x[14]);
+    }
+
+    for (int i = 0; i < 16; ++i) {
+        x[i] += input[i];
+    }
+
+    return x;
+}
+
 template<int rounds>
 array<uint32_t, 16> chacha(
         const array<uint32_t, 8> &key,
         const uint64_t nonce,
         const uint64_t counter)
 {
-    static_assert(rounds == 8 || rounds == 12 || rounds == 20);
-
     array<uint32_t, 16> input;
     input[0] = 0x61707865; // "expa"
     input[1] = 0x3320646e; // "nd 3"
@@ -111,30 +535,245 @@ array<uint32_t, 16> chacha(
     input[14] = static_cast<uint32_t>(nonce);
     input[15] = static_cast<uint32_t>(nonce >> 32);
 
-    array<uint32_t, 16> x = input;
-
-    for (int double_round = 0; double_round < rounds / 2; ++double_round) {
-        quarter_round(x[0], x[4], x[8], x[12]);
-        quarter_round(x[1], x[5], x[9], x[13]);
-        quarter_round(x[2], x[6], x[10], x[14]);
-        quarter_round(x[3], x[7], x[11], x[15]);
+    return chacha_rounds<rounds>(input);
+}
 
-        quarter_round(x[0], x[5], x[10], x[15]);
-        quarter_round(x[1], x[6], x[11], x[12]);
-        quarter_round(x[2], x[7], x[8], x[13]);
-        quarter_round(x[3], x[4], x[9], x[14]);
+// Blocks counter, counter + 1, ..., counter + num_parallel_blocks - 1,
+// concatenated.
+template<int rounds>
+array<uint32_t, word_buffer_size> chacha_blocks(
+        const array<uint32_t, 8> &key,
+        const uint64_t nonce,
+        const uint64_t counter)
+{
+    array<uint32x4, 16> input;
+    for (int i = 0; i < 16; ++i) {
+        input[i] = uint32x4{};
     }
+    input[0] += 0x61707865;
+    input[1] += 0x3320646e;
+    input[2] += 0x79622d32;
+    input[3] += 0x6b206574;
+    for (int i = 0; i < 8; ++i) {
+        input[4 + i] += key[i];
+    }
+    for (int lane = 0; lane < num_parallel_blocks; ++lane) {
+        input[12][lane] = static_cast<uint32_t>(counter + lane);
+        input[13][lane] = static_cast<uint32_t>((counter + lane) >> 32);
+    }
+    input[14] += static_cast<uint32_t>(nonce);
+    input[15] += static_cast<uint32_t>(nonce >> 32);
 
-    for (int i = 0; i < 16; ++i) {
-        x[i] += input[i];
+    const array<uint32x4, 16> x = chacha_rounds<rounds>(input);
+
+    array<uint32_t, word_buffer_size> output;
+    for (int lane = 0; lane < num_parallel_blocks; ++lane) {
+        for (int i = 0; i < 16; ++i) {
+            output[16 * lane + i] = x[i][lane];
+        }
     }
+    return output;
+}
+
+// exp, log and sqrt built from + - * / and exact scaling by powers of two,
+// so that they give the same results on every platform and can be used in
+// constant expressions.
 
+constexpr double ln2_hi = 6.93147180369123816490e-01;
+constexpr double ln2_lo = 1.90821492927058770002e-10;
+
+// x 2^k, exact unless the result is subnormal.
+constexpr double scale_by_power_of_two(double x, const int k) {
+    if (!__builtin_is_constant_evaluated()) {
+        return std::ldexp(x, k);
+    }
+    double base = k >= 0 ? 2.0 : 0.5;
+    for (unsigned e = k >= 0 ? k : -k; e != 0u; e >>= 1) {
+        if (e & 1u) {
+            x *= base;
+        }
+        base *= base;
+    }
     return x;
 }
 
+// Taylor series coefficients, precomputed so that no division is needed
+// at runtime.
+
+// 1/i!
+constexpr array<double, 14> make_inverse_factorials() {
+    array<double, 14> result{};
+    result[0] = 1.0;
+    for (int i = 1; i < 14; ++i) {
+        result[i] = result[i - 1] / i;
+    }
+    return result;
+}
+
+// 1/(2i+1)
+constexpr array<double, 12> make_inverse_odd_numbers() {
+    array<double, 12> result{};
+    for (int i = 0; i < 12; ++i) {
+        result[i] = 1.0 / (2 * i + 1);
+    }
+    return result;
+}
+
+constexpr array<double, 14> inverse_factorials = make_inverse_factorials();
+constexpr array<double, 12> inverse_odd_numbers = make_inverse_odd_numbers();
+
+constexpr double portable_exp(const double x) {
+    if (x > 709.0) {
+        return std::numeric_limits<double>::infinity();
+    }
+    if (x < -745.0) {
+        return 0.0;
+    }
+    // x = k ln 2 + r, |r| <= ln 2 / 2
+    const int k = static_cast<int>(x * 1.44269504088896340736 + (x >= 0.0 ? 0.5 : -0.5));
+    const double r = (x - k * ln2_hi) - k * ln2_lo;
+    // Taylor series. |r|^14 / 14! < 2^-56
+    double sum = inverse_factorials[13];
+    for (int i = 12; i >= 0; --i) {
+        sum = inverse_factorials[i] + sum * r;
+    }
+    return scale_by_power_of_two(sum, k);
+}
+
+// 2 atanh(s) = log((1 + s) / (1 - s)), |s| <= 0.18
+constexpr double log_atanh_series(const double s) {
+    // |s|^24 < 2^-60
+    const double s2 = s * s;
+    double sum = 0.0;
+    for (int i = 11; i >= 0; --i) {
+        sum = inverse_odd_numbers[i] + sum * s2;
+    }
+    return 2.0 * s * sum;
+}
+
+// x > 0
+constexpr double portable_log(double x) {
+    if (!(x > 0.0)) {
+        throw std::domain_error("log of non-positive number");
+    }
+    // x = m 2^e, sqrt(1/2) <= m < sqrt(2)
+    int e = 0;
+    if (!__builtin_is_constant_evaluated()) {
+        x = std::frexp(x, &e);
+    }
+    while (x >= 0x1p32) {
+        x *= 0x1p-32;
+        e += 32;
+    }
+    while (x < 0x1p-32) {
+        x *= 0x1p32;
+        e -= 32;
+    }
+    while (x >= 1.41421356237309504880) {
+        x *= 0.5;
+        ++e;
+    }
+    while (x < 0.70710678118654752440) {
+        x *= 2.0;
+        --e;
+    }
+    return log_atanh_series((x - 1.0) / (x + 1.0)) + e * ln2_lo + e * ln2_hi;
+}
+
+// log(1 + x), accurate for small x.
+constexpr double portable_log1p(const double x) {
+    if (x > -0.25 && x < 0.25) {
+        return log_atanh_series(x / (2.0 + x));
+    }
+    return portable_log(1.0 + x);
+}
+
+// Correctly rounded std::sqrt is preferable at runtime.
+constexpr double portable_sqrt(const double x) {
+    if (x == 0.0) {
+        return 0.0;
+    }
+    double y = x >= 1.0 ? x : 1.0;
+    for (;;) {
+        const double next = 0.5 * (y + x / y);
+        if (next >= y) {
+            return y;
+        }
+        y = next;
+    }
+}
+
+// log(k!) - stirling(k), where stirling(k) = (k + 1/2) log(k + 1) - (k + 1)
+// + log(2 pi) / 2.
+//
+// Used instead of log(k!) to avoid cancellation when k is large.
+inline double stirling_tail(const double k) {
+    static constexpr array<double, 10> table = {
+        0.0810614667953272,  0.0413406959554092,  0.0276779256849983,
+        0.02079067210376509, 0.0166446911898211,  0.0138761288230707,
+        0.0118967099458917,  0.0104112652619720,  0.00925546218271273,
+        0.00833056343336287,
+    };
+    if (k < 10.0) {
+        return table[static_cast<int>(k)];
+    }
+    const double k1 = k + 1.0;
+    const double k1_squared = k1 * k1;
+    return (1.0 / 12 - (1.0 / 360 - 1.0 / 1260 / k1_squared) / k1_squared) / k1;
+}
+
+// Ziggurat with 256 layers of equal area under a decreasing density f.
+//
+// Layer i, 1 <= i < 256, is the rectangle [0, x[i]] x [f[i], f[i+1]].
+// Layer 0 is [0, x[0]] x [0, f[1]]: the part with x > x[1] stands for
+// the tail beyond x[1].
+struct Ziggurat {
+    array<double, 257> x;
+    array<double, 257> f;
+};
+
+// Marsaglia, Tsang. The Ziggurat Method for Generating Random Variables.
+constexpr Ziggurat make_normal_ziggurat() {
+    constexpr double r = 3.6541528853610088;
+    constexpr double v = 4.92867323399e-3;
+    Ziggurat z{};
+    z.x[0] = v / portable_exp(-0.5 * r * r);
+    z.x[1] = r;
+    for (int i = 1; i < 256; ++i) {
+        z.f[i] = portable_exp(-0.5 * z.x[i] * z.x[i]);
+        const double next_f = v / z.x[i] + z.f[i];
+        z.x[i + 1] = i == 255 || next_f >= 1.0 ?
+            0.0 : portable_sqrt(-2.0 * portable_log(next_f));
+    }
+    z.f[0] = 0.0;
+    z.f[256] = 1.0;
+    return z;
+}
+
+constexpr Ziggurat make_exponential_ziggurat() {
+    constexpr double r = 7.69711747013104972;
+    constexpr double v = 3.9496598225815571993e-3;
+    Ziggurat z{};
+    z.x[0] = v / portable_exp(-r);
+    z.x[1] = r;
+    for (int i = 1; i < 256; ++i) {
+        z.f[i] = portable_exp(-z.x[i]);
+        const double next_f = v / z.x[i] + z.f[i];
+        z.x[i + 1] = i == 255 || next_f >= 1.0 ? 0.0 : -portable_log(next_f);
+    }
+    z.f[0] = 0.0;
+    z.f[256] = 1.0;
+    return z;
+}
+
+constexpr Ziggurat normal_ziggurat = make_normal_ziggurat();
+constexpr Ziggurat exponential_ziggurat = make_exponential_ziggurat();
+
 inline Random::Random(
         const std::string_view problem_name,
-        const uint32_t test_id)
+        const uint32_t test_id,
+        const Version version)
+    : m_version(version)
 {
     if (problem_name.size() > 4) {
         throw std::invalid_argument("problem_name too long");
@@ -149,32 +788,92 @@ inline Random::Random(
     }
 }
 
-inline uint64_t Random::bits(int n) {
-    if (n > 64) {
-        throw std::invalid_argument("n > 64");
+inline Random::Random(const array<uint32_t, 8> &key, const Version version)
+    : m_version(version), m_key(key), m_nonce(0)
+{
+}
+
+inline void Random::set_uniform_method(const UniformMethod method) {
+    m_uniform_method = method;
+}
+
+inline Random Random::substream() {
+    array<uint32_t, 8> child_key;
+    for (uint32_t &word : child_key) {
+        word = next_word32();
+    }
+    Random child(child_key, m_version);
+    child.m_uniform_method = m_uniform_method;
+    return child;
+}
+
+inline void Random::refill_words() {
+    m_word_buffer = chacha_blocks<20>(m_key, m_nonce, m_counter);
+    m_counter += num_parallel_blocks;
+    if (m_counter == 0) {
+        throw std::runtime_error("Random counter overflow");
+    }
+    m_word_buffer_next = 0;
+}
+
+inline uint32_t Random::next_word32() {
+    if (m_word_buffer_next == word_buffer_size) {
+        refill_words();
+    }
+    return m_word_buffer[m_word_buffer_next++];
+}
+
+inline uint64_t Random::next_word64() {
+    // Words are used in pairs, but next_word32 may have left a single word.
+    // Skip it.
+    if (m_word_buffer_next > word_buffer_size - 2) {
+        refill_words();
+    }
+    const uint64_t low = m_word_buffer[m_word_buffer_next];
+    const uint64_t high = m_word_buffer[m_word_buffer_next + 1];
+    m_word_buffer_next += 2;
+    return low | high << 32;
+}
+
+inline uint64_t Random::bits(const int n) {
+    if (n < 0 || n > 64) {
+        throw std::invalid_argument("n out of range");
+    }
+    if (m_version == Version::v1) {
+        return bits_v1(n);
+    }
+    if (n == 0) {
+        return 0;
     }
+    const uint64_t mask = ~uint64_t{0} >> (64 - n);
+    // Shifts are split in two because shifting by 64 is undefined.
+    if (n <= m_num_bits) {
+        const uint64_t result = m_bits_buffer & mask;
+        m_bits_buffer = m_bits_buffer >> (n - 1) >> 1;
+        m_num_bits -= n;
+        return result;
+    }
+    // m_num_bits < n <= 64
+    const uint64_t word = next_word64();
+    const uint64_t result = (m_bits_buffer | word << m_num_bits) & mask;
+    const int used = n - m_num_bits;
+    m_bits_buffer = word >> (used - 1) >> 1;
+    m_num_bits = 64 - used;
+    return result;
+}
+
+inline uint64_t Random::bits_v1(int n) {
     uint64_t result = 0;
     while (n >= m_num_bits) {
         result <<= m_num_bits;
         result |= m_bits_buffer;
         n -= m_num_bits;
-
-        // refill bits
-        if (m_word_buffer_next == 16) {
-            // refill words
-            m_word_buffer = chacha<20>(key, m_nonce, m_counter++);
-            m_word_buffer_next = 0;
-            if (m_counter == 0) {
-                throw std::runtime_error("Random counter overflow");
-            }
-            m_word_buffer_next = 0;
-        }
-        m_bits_buffer = m_word_buffer[m_word_buffer_next++];
+        m_bits_buffer = next_word32();
         m_num_bits = 32;
     }
     // n < m_num_bits <= 32
     result <<= n;
-    result |= m_bits_buffer & ((1u << n) - 1u);
+    result |= m_bits_buffer & ((uint64_t{1} << n) - 1u);
     m_bits_buffer >>= n;
     m_num_bits -= n;
     return result;
@@ -205,31 +904,871 @@ inline uint64_t Random::uniform_uint64(const uint64_t min, const uint64_t max) {
         return bits(64);
     }
     const uint64_t n = max - min + 1u;
-
-    for (;;) {
-        // refill number buffer
-        const int zeros = __builtin_clzll(m_number_range);
-        m_number_range <<= zeros;
-        m_number_buffer <<= zeros;
-        m_number_buffer |= bits(zeros);
-
-        const uint64_t num_groups = m_number_range / n;
-        const uint64_t small_group = m_number_range % n;
-        const uint64_t group = m_number_buffer / n;
-        const uint64_t in_group = m_number_buffer % n;
-        if (group < num_groups) {
-            m_number_range = num_groups;
-            m_number_buffer = group;
-            return min + in_group;
-        } else {
-            m_number_range = small_group;
-            m_number_buffer = in_group;
-        }
+    if (m_uniform_method == UniformMethod::multiply_shift) {
+        return min + uniform_multiply_shift(n);
     }
+    return min + uniform_buffered(n);
 }
 
-template <typename Iter>
-void Random::shuffle(Iter begin, Iter end) {
+inline unsigned __int128 Random::uniform_uint128(const unsigned __int128 min,
+                                                const unsigned __int128 max) {
+    if (min > max) {
+        throw std::invalid_argument("min > max");
+    }
+    const unsigned __int128 range = max - min;
+    const uint64_t high = static_cast<uint64_t>(range >> 64);
+    if (high == 0u) {
+        return min + uniform_uint64(0, static_cast<uint64_t>(range));
+    }
+    // Rejection from the smallest power of 2 above range, at least 2^65:
+    // accepted with probability > 1/2.
+    const int zeros = __builtin_clzll(high);
+    for (;;) {
+        unsigned __int128 x = next_word64();
+        x = x << 64 | next_word64();
+        x >>= zeros;
+        if (x <= range) {
+            return min + x;
+        }
+    }
+}
+
+inline __int128 Random::uniform_int128(const __int128 min, const __int128 max) {
+    if (min > max) {
+        throw std::invalid_argument("min > max");
+    }
+    const unsigned __int128 umin = static_cast<unsigned __int128>(min);
+    const unsigned __int128 umax = static_cast<unsigned __int128>(max);
+    return static_cast<__int128>(uniform_uint128(0, umax - umin) + umin);
+}
+
+inline std::string Random::uniform_decimal(const std::string_view min,
+                                           const std::string_view max) {
+    for (const std::string_view s : {min, max}) {
+        if (s.empty() || (s.size() > 1u && s[0] == '0') ||
+            !std::all_of(s.begin(), s.end(), [](const char c) { return c >= '0' && c <= '9'; })) {
+            throw std::invalid_argument("not a decimal integer");
+        }
+    }
+    if (min.size() > max.size() || (min.size() == max.size() && min > max)) {
+        throw std::invalid_argument("min > max");
+    }
+    const size_t n = max.size();
+    // Digit of min aligned with position i of max.
+    const size_t shift = n - min.size();
+    const auto min_digit = [&](const size_t i) { return i >= shift ? min[i - shift] - '0' : 0; };
+
+    // Digit values of max - min.
+    std::vector<int> range(n);
+    int borrow = 0;
+    for (size_t i = n; i-- > 0;) {
+        int d = max[i] - '0' - min_digit(i) - borrow;
+        borrow = d < 0;
+        range[i] = borrow ? d + 10 : d;
+    }
+    size_t first = 0;
+    while (first + 1u < n && range[first] == 0) {
+        ++first;
+    }
+
+    // Offset in [0, range]. The leading digit is uniform in
+    // [0, range[first]]. While the prefix equals that of range, the next
+    // digit is uniform in [0, 9] and the attempt is rejected if it is
+    // larger. Every offset is equally likely in an attempt and an attempt
+    // succeeds with probability > 1/2. Once the prefix is smaller the
+    // remaining digits are free.
+    std::string result(n, '0');
+    size_t i;
+    for (;;) {
+        i = first;
+        int d = uniform_int(0, range[i]);
+        result[i++] = static_cast<char>('0' + d);
+        bool tight = d == range[first];
+        while (tight && i < n) {
+            d = uniform_int(0, 9);
+            if (d > range[i]) {
+                break;
+            }
+            tight = d == range[i];
+            result[i++] = static_cast<char>('0' + d);
+        }
+        if (!tight || i == n) {
+            break;
+        }
+    }
+    fill_string(result.begin() + i, result.end(), "0123456789");
+
+    // Add min. There is no carry out since the sum is at most max.
+    int carry = 0;
+    for (size_t j = n; j-- > 0;) {
+        const int d = result[j] - '0' + min_digit(j) + carry;
+        carry = d >= 10;
+        result[j] = static_cast<char>('0' + (carry ? d - 10 : d));
+    }
+    const size_t leading_zeros = std::min(result.find_first_not_of('0'), n - 1u);
+    result.erase(0, leading_zeros);
+    return result;
+}
+
+// Uniform in [0, n).
+inline uint64_t Random::uniform_buffered(const uint64_t n) {
+    for (;;) {
+        // refill number buffer
+        const int zeros = __builtin_clzll(m_number_range);
+        m_number_range <<= zeros;
+        m_number_buffer <<= zeros;
+        m_number_buffer |= bits(zeros);
+
+        if (m_number_range < n) {
+            // Only when n > 2^63: the buffer can't hold n and would never
+            // grow. Leave it for later calls and use plain rejection.
+            for (;;) {
+                const uint64_t x = bits(64);
+                if (x < n) {
+                    return x;
+                }
+            }
+        }
+
+        const uint64_t num_groups = m_number_range / n;
+        const uint64_t small_group = m_number_range % n;
+        const uint64_t group = m_number_buffer / n;
+        const uint64_t in_group = m_number_buffer % n;
+        if (group < num_groups) {
+            m_number_range = num_groups;
+            m_number_buffer = group;
+            return in_group;
+        } else {
+            m_number_range = small_group;
+            m_number_buffer = in_group;
+        }
+    }
+}
+
+// Uniform in [0, n), n >= 1.
+//
+// x * n >> w is uniform for a uniform w-bit x, unless the low w bits of
+// x * n are below 2^w % n. Those are < n, so the modulo is only computed
+// when the low bits are < n.
+inline uint64_t Random::uniform_multiply_shift(const uint64_t n) {
+    if (n <= uint64_t{1} << 32) {
+        uint64_t product = next_word32() * n;
+        if (static_cast<uint32_t>(product) < n) {
+            const uint32_t threshold = static_cast<uint32_t>(0u - n) % n;
+            while (static_cast<uint32_t>(product) < threshold) {
+                product = next_word32() * n;
+            }
+        }
+        return product >> 32;
+    }
+    unsigned __int128 product = static_cast<unsigned __int128>(next_word64()) * n;
+    if (static_cast<uint64_t>(product) < n) {
+        const uint64_t threshold = (0u - n) % n;
+        while (static_cast<uint64_t>(product) < threshold) {
+            product = static_cast<unsigned __int128>(next_word64()) * n;
+        }
+    }
+    return static_cast<uint64_t>(product >> 64);
+}
+
+template <typename Iter, typename T>
+void Random::uniform_ints(Iter begin, Iter end, const T min, const T max) {
+    static_assert(std::is_integral_v<T> && sizeof(T) <= sizeof(uint64_t));
+    using U = std::make_unsigned_t<T>;
+    if (min > max) {
+        throw std::invalid_argument("min > max");
+    }
+    const uint64_t umin = static_cast<U>(min);
+    const uint64_t range = static_cast<U>(static_cast<U>(max) - static_cast<U>(min));
+    const auto value = [umin](const uint64_t x) {
+        return static_cast<T>(static_cast<U>(umin + x));
+    };
+
+    if (range <= std::numeric_limits<uint32_t>::max()) {
+        // x * n >> 32 is uniform in [0, n) for uniform 32-bit x, unless
+        // the low 32 bits of x * n fall below 2^32 % n.
+        const uint64_t n = range + 1u;
+        const uint64_t threshold = ((uint64_t{1} << 32) - n) % n;
+        while (begin != end) {
+            if (m_word_buffer_next == word_buffer_size) {
+                refill_words();
+            }
+            int next = m_word_buffer_next;
+            for (; next != word_buffer_size && begin != end; ++next) {
+                const uint64_t product = m_word_buffer[next] * n;
+                if (static_cast<uint32_t>(product) >= threshold) {
+                    *begin = value(product >> 32);
+                    ++begin;
+                }
+            }
+            m_word_buffer_next = next;
+        }
+    } else if (range == std::numeric_limits<uint64_t>::max()) {
+        for (; begin != end; ++begin) {
+            *begin = value(next_word64());
+        }
+    } else {
+        // Same as above, with 64-bit words.
+        const uint64_t n = range + 1u;
+        const uint64_t threshold = (0u - n) % n;
+        while (begin != end) {
+            const unsigned __int128 product =
+                static_cast<unsigned __int128>(next_word64()) * n;
+            if (static_cast<uint64_t>(product) >= threshold) {
+                *begin = value(static_cast<uint64_t>(product >> 64));
+                ++begin;
+            }
+        }
+    }
+}
+
+template <typename Iter>
+void Random::fill_string(Iter begin, const Iter end, const std::string_view alphabet) {
+    const uint64_t k = alphabet.size();
+    if (k == 0u || k > (uint64_t{1} << 32)) {
+        throw std::invalid_argument("invalid alphabet size");
+    }
+    if (k == 1u) {
+        std::fill(begin, end, alphabet[0]);
+        return;
+    }
+    const char *const chars = alphabet.data();
+    if ((k & (k - 1u)) == 0u && k <= 256u) {
+        // Bit slicing, with the number of bits known at compile time so
+        // that the loop over a word is unrolled.
+        const auto slice = [&](const auto bits_constant) {
+            constexpr int bits_per_char = decltype(bits_constant)::value;
+            constexpr int chars_per_word = 32 / bits_per_char;
+            constexpr uint32_t mask = (uint32_t{1} << bits_per_char) - 1u;
+            while (end - begin >= chars_per_word) {
+                if (m_word_buffer_next == word_buffer_size) {
+                    refill_words();
+                }
+                const int first = m_word_buffer_next;
+                const int count = static_cast<int>(std::min<uint64_t>(
+                    word_buffer_size - first, (end - begin) / chars_per_word));
+                const Iter out = begin;
+                for (int w = 0; w != count; ++w) {
+                    uint32_t word = m_word_buffer[first + w];
+                    for (int i = 0; i != chars_per_word; ++i) {
+                        out[w * chars_per_word + i] = chars[word & mask];
+                        word >>= bits_per_char;
+                    }
+                }
+                m_word_buffer_next = first + count;
+                begin = out + count * chars_per_word;
+            }
+            if (begin != end) {
+                for (uint32_t word = next_word32(); begin != end; ++begin) {
+                    *begin = chars[word & mask];
+                    word >>= bits_per_char;
+                }
+            }
+        };
+        switch (__builtin_ctzll(k)) {
+        case 1: slice(std::integral_constant<int, 1>()); break;
+        case 2: slice(std::integral_constant<int, 2>()); break;
+        case 3: slice(std::integral_constant<int, 3>()); break;
+        case 4: slice(std::integral_constant<int, 4>()); break;
+        case 5: slice(std::integral_constant<int, 5>()); break;
+        case 6: slice(std::integral_constant<int, 6>()); break;
+        case 7: slice(std::integral_constant<int, 7>()); break;
+        default: slice(std::integral_constant<int, 8>()); break;
+        }
+    } else {
+        // floor(x * k^digits / 2^32) is uniform, with the usual
+        // multiply-shift rejection. Its base-k digits are obtained by
+        // multiplying the fraction x / 2^32 by k repeatedly.
+        uint64_t power = k;
+        int digits = 1;
+        while (power <= (uint64_t{1} << 32) / k) {
+            power *= k;
+            ++digits;
+        }
+        const uint32_t threshold = ((uint64_t{1} << 32) - power) % power;
+        while (begin != end) {
+            const uint32_t word = next_word32();
+            if (static_cast<uint32_t>(word * power) < threshold) {
+                continue;
+            }
+            uint64_t fraction = word;
+            for (int i = 0; i != digits && begin != end; ++i, ++begin) {
+                fraction *= k;
+                *begin = chars[fraction >> 32];
+                fraction = static_cast<uint32_t>(fraction);
+            }
+        }
+    }
+}
+
+template <typename Iter>
+void Random::balanced_brackets(const Iter begin, const Iter end,
+                               const char open, const char close) {
+    const uint64_t length = end - begin;
+    if (length % 2u != 0u) {
+        throw std::invalid_argument("odd length");
+    }
+    // Positions 0, ..., length-1 go to [begin, end), position length is
+    // kept in last. Each position is open with probability
+    // (remaining opens) / (remaining positions). Multiply-shift is used
+    // regardless of the uniform method, for speed.
+    uint64_t num_open = length / 2u;
+    int64_t depth = 0;
+    int64_t min_depth = 0;
+    // Number of brackets before the first minimum of depth.
+    uint64_t rotation = 0;
+    for (uint64_t i = 0; i < length; ++i) {
+        if (uniform_multiply_shift(length + 1u - i) < num_open) {
+            begin[i] = open;
+            --num_open;
+            ++depth;
+        } else {
+            begin[i] = close;
+            if (--depth < min_depth) {
+                min_depth = depth;
+                rotation = i + 1u;
+            }
+        }
+    }
+    // Position length must be close if there are no opens left.
+    const char last = num_open != 0u ? open : close;
+    if (last == close && depth - 1 < min_depth) {
+        rotation = length + 1u;
+    }
+    if (rotation == length + 1u) {
+        // Drop last.
+        return;
+    }
+    // Rotate the length + 1 positions left by rotation and drop the final
+    // close bracket, which was at position rotation - 1.
+    std::rotate(begin, begin + rotation, end);
+    std::copy_backward(end - rotation, end - 1, end);
+    *(end - rotation) = last;
+}
+
+inline StringTable Random::distinct_strings(const std::vector<size_t> &lengths,
+                                            const std::string_view alphabet) {
+    if (alphabet.empty()) {
+        throw std::invalid_argument("empty alphabet");
+    }
+    StringTable table;
+    table.offsets.reserve(lengths.size() + 1u);
+    // Number of strings requested per length, to check that there are
+    // enough distinct ones.
+    std::vector<size_t> counts;
+    for (const size_t length : lengths) {
+        if (length >= counts.size()) {
+            counts.resize(length + 1u);
+        }
+        ++counts[length];
+        table.offsets.push_back(table.offsets.back() + length);
+    }
+    for (size_t length = 0; length < counts.size(); ++length) {
+        // Stop once alphabet.size()^length >= counts[length].
+        uint64_t num_possible = 1;
+        for (size_t i = 0; i < length && num_possible < counts[length]; ++i) {
+            num_possible *= alphabet.size();
+        }
+        if (num_possible < counts[length]) {
+            throw std::invalid_argument("not enough distinct strings");
+        }
+    }
+    table.bytes.resize(table.offsets.back());
+
+    // Open addressing with linear probing. Slots hold index + 1, 0 if
+    // empty.
+    int log_num_slots = 4;
+    while ((size_t{1} << log_num_slots) < 2u * lengths.size()) {
+        ++log_num_slots;
+    }
+    std::vector<size_t> slots(size_t{1} << log_num_slots);
+    const size_t mask = slots.size() - 1u;
+    const std::hash<std::string_view> hash;
+    for (size_t i = 0; i < lengths.size(); ++i) {
+        const auto first = table.bytes.begin() + table.offsets[i];
+        for (;;) {
+            fill_string(first, first + lengths[i], alphabet);
+            const std::string_view s = table[i];
+            // Fibonacci hashing of the standard hash, in case the low bits
+            // are weak.
+            size_t slot = static_cast<size_t>(
+                (static_cast<uint64_t>(hash(s)) * 0x9E3779B97F4A7C15u) >> (64 - log_num_slots));
+            while (slots[slot] != 0u && table[slots[slot] - 1u] != s) {
+                slot = (slot + 1u) & mask;
+            }
+            if (slots[slot] == 0u) {
+                slots[slot] = i + 1u;
+                break;
+            }
+        }
+    }
+    return table;
+}
+
+// Uniform from a grid of 2^digits points in [0, 1], including or excluding
+// 0 and 1 as requested.
+template <typename T>
+T Random::unit_real(const Interval interval) {
+    static_assert(std::is_floating_point_v<T>);
+    constexpr int digits = std::numeric_limits<T>::digits;
+    static_assert(digits <= 64, "unsupported floating point type");
+    const auto random_digits = [this] {
+        if constexpr (digits <= 32) {
+            return static_cast<uint64_t>(next_word32() >> (32 - digits));
+        } else {
+            return next_word64() >> (64 - digits);
+        }
+    };
+    // 2^-digits
+    constexpr T unit = T(1) / T(uint64_t{1} << (digits - 1)) / T(2);
+
+    switch (interval) {
+    case Interval::closed: {
+        // 2^digits + 1 points may not fit, so use one less digit if needed.
+        constexpr int closed_digits = std::min(digits, 63);
+        constexpr T closed_unit = unit * T(uint64_t{1} << (digits - closed_digits));
+        const uint64_t k =
+            uniform_multiply_shift((uint64_t{1} << closed_digits) + 1u);
+        return T(k) * closed_unit;
+    }
+    case Interval::closed_open:
+        return T(random_digits()) * unit;
+    case Interval::open_closed:
+        return T(1) - T(random_digits()) * unit;
+    case Interval::open:
+        for (;;) {
+            const uint64_t k = random_digits();
+            if (k != 0u) {
+                return T(k) * unit;
+            }
+        }
+    }
+    throw std::invalid_argument("invalid interval");
+}
+
+template <typename T>
+T Random::uniform_real(const T min, const T max, const Interval interval) {
+    if (!std::isfinite(min) || !std::isfinite(max)) {
+        throw std::invalid_argument("infinite bounds");
+    }
+    if (interval == Interval::closed ? !(min <= max) : !(min < max)) {
+        throw std::invalid_argument("empty interval");
+    }
+    if (interval == Interval::open && !(std::nextafter(min, max) < max)) {
+        throw std::invalid_argument("empty interval");
+    }
+    return uniform_real_unchecked(min, max, interval);
+}
+
+template <typename Iter, typename T>
+void Random::uniform_reals(
+        Iter begin,
+        const Iter end,
+        const T min,
+        const T max,
+        const Interval interval)
+{
+    if (begin == end) {
+        return;
+    }
+    // Validates the arguments.
+    *begin = uniform_real(min, max, interval);
+    for (++begin; begin != end; ++begin) {
+        *begin = uniform_real_unchecked(min, max, interval);
+    }
+}
+
+template <typename T>
+T Random::uniform_real_unchecked(const T min, const T max, const Interval interval) {
+    const bool allow_min =
+        interval == Interval::closed || interval == Interval::closed_open;
+    const bool allow_max =
+        interval == Interval::closed || interval == Interval::open_closed;
+    for (;;) {
+        const T u = unit_real<T>(interval);
+        // Exact at the endpoints and can't overflow.
+        const T x = min * (T(1) - u) + max * u;
+        // Rounding may hit an excluded endpoint.
+        if ((x != min || allow_min) && (x != max || allow_max)) {
+            return x;
+        }
+    }
+}
+
+inline double Random::normal(const double mean, const double stddev) {
+    if (!(stddev >= 0.0)) {
+        throw std::invalid_argument("stddev < 0");
+    }
+    return mean + stddev * standard_normal();
+}
+
+inline double Random::exponential(const double lambda) {
+    if (!(lambda > 0.0)) {
+        throw std::invalid_argument("lambda <= 0");
+    }
+    return standard_exponential() / lambda;
+}
+
+inline double Random::standard_normal() {
+    const Ziggurat &z = normal_ziggurat;
+    for (;;) {
+        // bits 0-7: layer, bit 8: sign, bits 11-63: position in layer
+        const uint64_t word = next_word64();
+        const int i = word & 255u;
+        const double sign = (word >> 8) & 1u ? -1.0 : 1.0;
+        const double x = static_cast<double>(word >> 11) * 0x1p-53 * z.x[i];
+        if (x < z.x[i + 1]) {
+            return sign * x;
+        }
+        if (i == 0) {
+            // Tail beyond r: Marsaglia's method.
+            const double r = z.x[1];
+            for (;;) {
+                const double a = -portable_log(unit_real<double>(Interval::open_closed)) / r;
+                const double b = -portable_log(unit_real<double>(Interval::open_closed));
+                if (2.0 * b >= a * a) {
+                    return sign * (r + a);
+                }
+            }
+        }
+        const double y = z.f[i] + unit_real<double>(Interval::closed_open) * (z.f[i + 1] - z.f[i]);
+        if (y < portable_exp(-0.5 * x * x)) {
+            return sign * x;
+        }
+    }
+}
+
+inline double Random::standard_exponential() {
+    const Ziggurat &z = exponential_ziggurat;
+    double offset = 0.0;
+    for (;;) {
+        // bits 0-7: layer, bits 11-63: position in layer
+        const uint64_t word = next_word64();
+        const int i = word & 255u;
+        const double x = static_cast<double>(word >> 11) * 0x1p-53 * z.x[i];
+        if (x < z.x[i + 1]) {
+            return offset + x;
+        }
+        if (i == 0) {
+            // The tail beyond r is r + another exponential.
+            offset += z.x[1];
+            continue;
+        }
+        const double y = z.f[i] + unit_real<double>(Interval::closed_open) * (z.f[i + 1] - z.f[i]);
+        if (y < portable_exp(-x)) {
+            return offset + x;
+        }
+    }
+}
+
+inline uint64_t Random::binomial(const uint64_t n, double p) {
+    if (!(p >= 0.0 && p <= 1.0)) {
+        throw std::invalid_argument("p out of range");
+    }
+    const bool flip = p > 0.5;
+    if (flip) {
+        p = 1.0 - p;
+    }
+    const double n_real = static_cast<double>(n);
+    const double q = 1.0 - p;
+    uint64_t result = 0;
+    if (p == 0.0 || n == 0u) {
+        result = 0;
+    } else if (n_real * p < 10.0) {
+        // Inversion.
+        const double q_to_n = portable_exp(n_real * portable_log1p(-p));
+        const double bound = std::min(n_real, n_real * p + 10.0 * std::sqrt(n_real * p * q + 1.0));
+        double u = unit_real<double>(Interval::closed_open);
+        double probability = q_to_n;
+        while (u > probability) {
+            ++result;
+            if (result > bound) {
+                // Rounding errors. Start over.
+                result = 0;
+                probability = q_to_n;
+                u = unit_real<double>(Interval::closed_open);
+            } else {
+                u -= probability;
+                probability *= (n_real - result + 1) * p / (result * q);
+            }
+        }
+    } else {
+        // BTRS: Hormann, The generation of binomial random variates.
+        //
+        // Candidates are m + x, where m is the mode. Working with x keeps
+        // the arithmetic exact for n beyond 2^53.
+        int exponent = 0;
+        const double mantissa = std::frexp(p, &exponent);
+        // p = p_numerator / 2^shift, shift < 128 because n p >= 10
+        const unsigned __int128 p_numerator =
+            static_cast<uint64_t>(std::ldexp(mantissa, 53));
+        const int shift = 53 - exponent;
+        // floor((n + 1) p)
+        const uint64_t m = static_cast<uint64_t>((p_numerator * n + p_numerator) >> shift);
+        // n p + 1/2 - m
+        const double c = std::ldexp(static_cast<double>(
+            static_cast<__int128>(p_numerator * n) -
+            static_cast<__int128>(static_cast<unsigned __int128>(m) << shift)), -shift) + 0.5;
+        const uint64_t n_minus_m = n - m;
+
+        const double stddev = std::sqrt(n_real * p * q);
+        const double b = 1.15 + 2.53 * stddev;
+        const double a = -0.0873 + 0.0248 * b + 0.01 * p;
+        const double v_r = 0.92 - 4.2 / b;
+        const double r = p / q;
+        const double alpha = (2.83 + 5.1 / b) * stddev;
+        const double m_real = static_cast<double>(m);
+        const double n_minus_m_real = static_cast<double>(n_minus_m);
+        for (;;) {
+            const double u = unit_real<double>(Interval::open) - 0.5;
+            double v = unit_real<double>(Interval::open_closed);
+            const double us = 0.5 - std::fabs(u);
+            const double x = std::floor((2.0 * a / us + b) * u + c);
+            if (x < 0.0 ? -x > m_real || static_cast<uint64_t>(-x) > m
+                        : x > n_minus_m_real || static_cast<uint64_t>(x) > n_minus_m) {
+                continue;
+            }
+            const uint64_t k = x < 0.0 ? m - static_cast<uint64_t>(-x) : m + static_cast<uint64_t>(x);
+            if (us >= 0.07 && v <= v_r) {
+                result = k;
+                break;
+            }
+            v = portable_log(v * alpha / (a / (us * us) + b));
+            // log(P(k) / P(m))
+            const double k_real = static_cast<double>(k);
+            const double n_minus_k_real = static_cast<double>(n - k);
+            const double upper_bound =
+                -(m_real + 0.5) * portable_log1p(x / (m_real + 1.0)) -
+                (n_minus_m_real + 0.5) * portable_log1p(-x / (n_minus_m_real + 1.0)) +
+                x * portable_log(r * (n_minus_k_real + 1.0) / (k_real + 1.0)) +
+                stirling_tail(m_real) + stirling_tail(n_minus_m_real) -
+                stirling_tail(k_real) - stirling_tail(n_minus_k_real);
+            if (v <= upper_bound) {
+                result = k;
+                break;
+            }
+        }
+    }
+    return flip ? n - result : result;
+}
+
+inline uint64_t Random::poisson(const double lambda) {
+    if (!(lambda >= 0.0) || !std::isfinite(lambda)) {
+        throw std::invalid_argument("lambda out of range");
+    }
+    if (lambda == 0.0) {
+        return 0;
+    }
+    if (lambda < 10.0) {
+        // Inversion.
+        const double exp_lambda = portable_exp(-lambda);
+        for (;;) {
+            double u = unit_real<double>(Interval::closed_open);
+            double probability = exp_lambda;
+            // The remaining mass beyond 200 is negligible, so going further
+            // means rounding errors.
+            for (uint64_t k = 0; k < 200u; ++k) {
+                if (u <= probability) {
+                    return k;
+                }
+                u -= probability;
+                probability *= lambda / (k + 1);
+            }
+        }
+    }
+    // PTRS: Hormann, The transformed rejection method for generating
+    // Poisson random variables.
+    const double sqrt_lambda = std::sqrt(lambda);
+    const double b = 0.931 + 2.53 * sqrt_lambda;
+    const double a = -0.059 + 0.02483 * b;
+    const double log_inv_alpha = portable_log(1.1239 + 1.1328 / (b - 3.4));
+    const double v_r = 0.9277 - 3.6224 / (b - 2.0);
+    for (;;) {
+        const double u = unit_real<double>(Interval::open) - 0.5;
+        const double v = unit_real<double>(Interval::open_closed);
+        const double us = 0.5 - std::fabs(u);
+        const double k = std::floor((2.0 * a / us + b) * u + lambda + 0.43);
+        if (k < 0.0) {
+            continue;
+        }
+        if (us >= 0.07 && v <= v_r) {
+            return static_cast<uint64_t>(k);
+        }
+        if (us < 0.013 && v > us) {
+            continue;
+        }
+        // log(lambda^k e^-lambda / k!), written to avoid cancellation.
+        const double log_probability =
+            (k + 1.0 - lambda) + k * portable_log1p((lambda - k - 1.0) / (k + 1.0)) -
+            0.5 * portable_log(k + 1.0) - 0.91893853320467274178 - stirling_tail(k);
+        if (portable_log(v) + log_inv_alpha - portable_log(a / (us * us) + b) <= log_probability) {
+            return static_cast<uint64_t>(k);
+        }
+    }
+}
+
+inline uint64_t Random::geometric(const double p) {
+    if (!(p > 0.0 && p <= 1.0)) {
+        throw std::invalid_argument("p out of range");
+    }
+    if (p == 1.0) {
+        return 0;
+    }
+    // Inversion: P(result >= k) = (1 - p)^k
+    const double u = unit_real<double>(Interval::open_closed);
+    const double result = std::floor(portable_log(u) / portable_log1p(-p));
+    if (!(result < 0x1p64)) {
+        return std::numeric_limits<uint64_t>::max();
+    }
+    return static_cast<uint64_t>(result);
+}
+
+template <typename T>
+UniformIntDistribution<T>::UniformIntDistribution(const T min, const T max)
+    : m_min(min), m_max(max)
+{
+    static_assert(std::is_integral_v<T> && sizeof(T) <= sizeof(uint64_t));
+    using U = std::make_unsigned_t<T>;
+    if (min > max) {
+        throw std::invalid_argument("min > max");
+    }
+    const uint64_t range = static_cast<U>(static_cast<U>(max) - static_cast<U>(min));
+    m_n = range + 1u;
+    if (m_n == 0u) {
+        m_threshold = 0;
+    } else if (m_n <= uint64_t{1} << 32) {
+        m_threshold = ((uint64_t{1} << 32) - m_n) % m_n;
+    } else {
+        m_threshold = (0u - m_n) % m_n;
+    }
+}
+
+template <typename T>
+T Random::sample(const UniformIntDistribution<T> &distribution) {
+    using U = std::make_unsigned_t<T>;
+    const uint64_t n = distribution.m_n;
+    uint64_t x;
+    if (n - 1u < uint64_t{1} << 32) {
+        uint64_t product;
+        do {
+            product = next_word32() * n;
+        } while (static_cast<uint32_t>(product) < distribution.m_threshold);
+        x = product >> 32;
+    } else if (n == 0u) {
+        x = next_word64();
+    } else {
+        unsigned __int128 product;
+        do {
+            product = static_cast<unsigned __int128>(next_word64()) * n;
+        } while (static_cast<uint64_t>(product) < distribution.m_threshold);
+        x = static_cast<uint64_t>(product >> 64);
+    }
+    return static_cast<T>(static_cast<U>(static_cast<U>(distribution.m_min) + x));
+}
+
+template <typename Iter>
+DiscreteDistribution::DiscreteDistribution(Iter begin, const Iter end) {
+    using T = typename std::iterator_traits<Iter>::value_type;
+    std::vector<uint64_t> weights;
+    if constexpr (std::is_integral_v<T>) {
+        for (; begin != end; ++begin) {
+            if (*begin < 0) {
+                throw std::invalid_argument("negative weight");
+            }
+            weights.push_back(static_cast<uint64_t>(*begin));
+        }
+    } else {
+        // double arithmetic, so that the table is the same on every platform.
+        std::vector<double> real_weights;
+        double max_weight = 0.0;
+        for (; begin != end; ++begin) {
+            const double weight = static_cast<double>(*begin);
+            if (!(weight >= 0.0) || !std::isfinite(weight)) {
+                throw std::invalid_argument("invalid weight");
+            }
+            real_weights.push_back(weight);
+            max_weight = std::max(max_weight, weight);
+        }
+        if (!(max_weight > 0.0)) {
+            throw std::invalid_argument("all weights zero");
+        }
+        // Exact scaling by a power of 2 so that the total can't overflow.
+        int exponent;
+        std::frexp(max_weight, &exponent);
+        double total = 0.0;
+        for (double &weight : real_weights) {
+            weight = std::ldexp(weight, -exponent);
+            total += weight;
+        }
+        const double scale = 0x1p62 / total;
+        for (const double weight : real_weights) {
+            weights.push_back(static_cast<uint64_t>(weight * scale));
+        }
+    }
+    build(weights);
+}
+
+inline void DiscreteDistribution::build(const std::vector<uint64_t> &weights) {
+    const size_t n = weights.size();
+    if (n == 0u || n > std::numeric_limits<uint32_t>::max()) {
+        throw std::invalid_argument("invalid number of weights");
+    }
+    uint64_t total = 0;
+    for (const uint64_t weight : weights) {
+        if (__builtin_add_overflow(total, weight, &total)) {
+            throw std::invalid_argument("total weight too large");
+        }
+    }
+    if (total == 0u) {
+        throw std::invalid_argument("all weights zero");
+    }
+
+    // Each column holds capacity = total / g levels, g = gcd(n, total).
+    // Weights are scaled by n / g so that they sum to n * capacity.
+    const uint64_t g = std::gcd(static_cast<uint64_t>(n), total);
+    const uint64_t capacity = total / g;
+    const uint64_t multiplier = n / g;
+
+    std::vector<unsigned __int128> scaled(n);
+    std::vector<uint32_t> small;
+    std::vector<uint32_t> large;
+    for (size_t i = 0; i < n; ++i) {
+        scaled[i] = static_cast<unsigned __int128>(weights[i]) * multiplier;
+        (scaled[i] < capacity ? small : large).push_back(static_cast<uint32_t>(i));
+    }
+
+    m_threshold.assign(n, capacity);
+    m_alias.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        m_alias[i] = static_cast<uint32_t>(i);
+    }
+    while (!small.empty() && !large.empty()) {
+        const uint32_t s = small.back();
+        small.pop_back();
+        const uint32_t l = large.back();
+        m_threshold[s] = static_cast<uint64_t>(scaled[s]);
+        m_alias[s] = l;
+        scaled[l] -= capacity - scaled[s];
+        if (scaled[l] < capacity) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    // Arithmetic is exact, so all remaining columns are full.
+
+    m_column = UniformIntDistribution<uint32_t>(0, static_cast<uint32_t>(n - 1u));
+    m_level = UniformIntDistribution<uint64_t>(0, capacity - 1u);
+}
+
+inline size_t Random::sample(const DiscreteDistribution &distribution) {
+    const uint32_t column = sample(distribution.m_column);
+    const uint64_t level = sample(distribution.m_level);
+    return level < distribution.m_threshold[column] ?
+        column : distribution.m_alias[column];
+}
+
+template <typename Iter>
+void Random::shuffle(Iter begin, Iter end) {
     const uint64_t n = end - begin;
     for (uint64_t i=1; i < n; ++i) {
         const uint64_t j = uniform_uint64(0, i);
@@ -237,8 +1776,975 @@ void Random::shuffle(Iter begin, Iter end) {
     }
 }
 
+// Runs task(0), ..., task(num_tasks - 1) on num_threads threads.
+template <typename F>
+void run_parallel(const size_t num_tasks, const unsigned num_threads, const F &task) {
+    std::atomic<size_t> next_task{0};
+    const auto worker = [&] {
+        for (size_t i = next_task++; i < num_tasks; i = next_task++) {
+            task(i);
+        }
+    };
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < num_threads && i < num_tasks; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+// [begin, mid) and [mid, end) are uniformly shuffled. Makes [begin, end)
+// uniformly shuffled.
+//
+// Bacher, Bodini, Hollender, Lumbroso. MergeShuffle: A Very Fast, Parallel
+// Random Permutation Algorithm.
+template <typename Iter>
+void merge_shuffled(Random &random, const Iter begin, const Iter mid, const Iter end) {
+    Iter i = begin;
+    Iter j = mid;
+    for (;; ++i) {
+        if (random.bits(1)) {
+            if (j == end) {
+                break;
+            }
+            std::iter_swap(i, j);
+            ++j;
+        } else if (i == j) {
+            break;
+        }
+    }
+    // Insert the rest one by one.
+    for (; i != end; ++i) {
+        std::iter_swap(i, begin + random.uniform_uint64(0, i - begin));
+    }
+}
+
+// Target number of elements in a parallel_shuffle block.
+constexpr uint64_t parallel_shuffle_block_size = uint64_t{1} << 16;
+
+template <typename Iter>
+void Random::parallel_shuffle(const Iter begin, const Iter end, unsigned num_threads) {
+    if (num_threads == 0u) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const uint64_t n = end - begin;
+    // Power of 2 so that merges are balanced.
+    uint64_t num_blocks = 1;
+    while (num_blocks * parallel_shuffle_block_size < n) {
+        num_blocks *= 2u;
+    }
+    const auto block_begin = [&](const uint64_t i) {
+        return begin + static_cast<uint64_t>(
+            static_cast<unsigned __int128>(n) * i / num_blocks);
+    };
+
+    std::vector<Random> block_randoms;
+    for (uint64_t i = 0; i < num_blocks; ++i) {
+        block_randoms.push_back(substream());
+    }
+    run_parallel(num_blocks, num_threads, [&](const size_t i) {
+        block_randoms[i].shuffle(block_begin(i), block_begin(i + 1u));
+    });
+
+    for (uint64_t width = 2; width <= num_blocks; width *= 2u) {
+        const uint64_t num_merges = num_blocks / width;
+        std::vector<Random> merge_randoms;
+        for (uint64_t i = 0; i < num_merges; ++i) {
+            merge_randoms.push_back(substream());
+        }
+        run_parallel(num_merges, num_threads, [&](const size_t i) {
+            merge_shuffled(merge_randoms[i],
+                           block_begin(i * width),
+                           block_begin(i * width + width / 2u),
+                           block_begin(i * width + width));
+        });
+    }
+}
+
+inline HashSet64::HashSet64(const size_t expected_size) {
+    // Load factor at most 1/2.
+    int log_size = 4;
+    while ((size_t{1} << log_size) < 2 * expected_size) {
+        ++log_size;
+    }
+    m_slots.assign(size_t{1} << log_size, empty_key);
+    m_shift = 64 - log_size;
+}
+
+inline bool HashSet64::insert(const uint64_t x) {
+    if (x == empty_key) {
+        const bool inserted = !m_contains_empty_key;
+        m_contains_empty_key = true;
+        m_size += inserted;
+        return inserted;
+    }
+    const size_t mask = m_slots.size() - 1u;
+    for (size_t i = slot(x); ; i = (i + 1u) & mask) {
+        if (m_slots[i] == x) {
+            return false;
+        }
+        if (m_slots[i] == empty_key) {
+            m_slots[i] = x;
+            ++m_size;
+            if (2 * m_size > m_slots.size()) {
+                grow();
+            }
+            return true;
+        }
+    }
+}
+
+inline bool HashSet64::erase(const uint64_t x) {
+    if (x == empty_key) {
+        const bool erased = m_contains_empty_key;
+        m_contains_empty_key = false;
+        m_size -= erased;
+        return erased;
+    }
+    const size_t mask = m_slots.size() - 1u;
+    size_t hole = slot(x);
+    while (m_slots[hole] != x) {
+        if (m_slots[hole] == empty_key) {
+            return false;
+        }
+        hole = (hole + 1u) & mask;
+    }
+    // Backward-shift deletion: move later elements of the probe run into
+    // the hole unless that would put them before their home slot.
+    for (size_t i = (hole + 1u) & mask; m_slots[i] != empty_key; i = (i + 1u) & mask) {
+        const size_t home = slot(m_slots[i]);
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            m_slots[hole] = m_slots[i];
+            hole = i;
+        }
+    }
+    m_slots[hole] = empty_key;
+    --m_size;
+    return true;
+}
+
+inline bool HashSet64::contains(const uint64_t x) const {
+    if (x == empty_key) {
+        return m_contains_empty_key;
+    }
+    const size_t mask = m_slots.size() - 1u;
+    for (size_t i = slot(x); ; i = (i + 1u) & mask) {
+        if (m_slots[i] == x) {
+            return true;
+        }
+        if (m_slots[i] == empty_key) {
+            return false;
+        }
+    }
+}
+
+inline void HashSet64::grow() {
+    std::vector<uint64_t> old_slots(2 * m_slots.size(), empty_key);
+    old_slots.swap(m_slots);
+    --m_shift;
+    const size_t mask = m_slots.size() - 1u;
+    for (const uint64_t x : old_slots) {
+        if (x != empty_key) {
+            size_t i = slot(x);
+            while (m_slots[i] != empty_key) {
+                i = (i + 1u) & mask;
+            }
+            m_slots[i] = x;
+        }
+    }
+}
+
+inline SortedSample Random::sorted_sample(const uint64_t k, const uint64_t n) {
+    return SortedSample(*this, k, n);
+}
+
+inline SortedSample::SortedSample(Random &random, const uint64_t k, const uint64_t n)
+    : m_random(random), m_remaining(k), m_population(n)
+{
+    if (k > n) {
+        throw std::invalid_argument("k > n");
+    }
+    // Algorithm A is faster when k is at least n / 13.
+    m_use_a = k >= n / 13u;
+    if (!m_use_a) {
+        m_v_prime = portable_exp(portable_log(uniform()) / static_cast<double>(k));
+    }
+}
+
+inline uint64_t SortedSample::next() {
+    if (m_remaining == 0u) {
+        throw std::logic_error("SortedSample::next with nothing remaining");
+    }
+    if (!m_use_a && m_remaining >= m_population / 13u) {
+        m_use_a = true;
+    }
+    uint64_t skip;
+    if (m_remaining == 1u) {
+        skip = m_random.uniform_uint64(0, m_population - 1u);
+    } else if (m_use_a) {
+        skip = skip_a();
+    } else {
+        skip = skip_d();
+    }
+    const uint64_t value = m_position + skip;
+    m_position = value + 1u;
+    m_population -= skip + 1u;
+    --m_remaining;
+    return value;
+}
+
+inline double SortedSample::uniform() {
+    return m_random.unit_real<double>(Random::Interval::open);
+}
+
+// Number of values to skip: sequential search for the inverse of its
+// distribution.
+inline uint64_t SortedSample::skip_a() {
+    double top = static_cast<double>(m_population - m_remaining);
+    double population = static_cast<double>(m_population);
+    const double v = uniform();
+    uint64_t skip = 0;
+    double quotient = top / population;
+    while (quotient > v) {
+        ++skip;
+        top -= 1.0;
+        population -= 1.0;
+        quotient = quotient * top / population;
+    }
+    return skip;
+}
+
+// Number of values to skip: rejection from a continuous approximation.
+inline uint64_t SortedSample::skip_d() {
+    const uint64_t n = m_remaining;
+    const uint64_t population = m_population;
+    const double n_real = static_cast<double>(n);
+    const double n_inv = 1.0 / n_real;
+    const double n_minus_1_inv = 1.0 / (n_real - 1.0);
+    const double population_real = static_cast<double>(population);
+    const uint64_t qu1 = population - n + 1u;
+    const double qu1_real = static_cast<double>(qu1);
+    for (;;) {
+        double x;
+        uint64_t skip;
+        for (;;) {
+            x = population_real * (1.0 - m_v_prime);
+            skip = static_cast<uint64_t>(x);
+            if (skip < qu1) {
+                break;
+            }
+            m_v_prime = portable_exp(portable_log(uniform()) * n_inv);
+        }
+        const double skip_real = static_cast<double>(skip);
+        const double u = uniform();
+        const double y1 = portable_exp(portable_log(u * population_real / qu1_real) * n_minus_1_inv);
+        m_v_prime = y1 * (1.0 - x / population_real) * (qu1_real / (qu1_real - skip_real));
+        if (m_v_prime <= 1.0) {
+            return skip;
+        }
+
+        // Exact test.
+        double y2 = 1.0;
+        double top = population_real - 1.0;
+        double bottom;
+        uint64_t limit;
+        if (n - 1u > skip) {
+            bottom = population_real - n_real;
+            limit = population - skip;
+        } else {
+            bottom = population_real - skip_real - 1.0;
+            limit = qu1;
+        }
+        for (uint64_t t = population - 1u; t >= limit; --t) {
+            y2 = y2 * top / bottom;
+            top -= 1.0;
+            bottom -= 1.0;
+        }
+        if (population_real / (population_real - x) >=
+                y1 * portable_exp(portable_log(y2) * n_minus_1_inv)) {
+            m_v_prime = portable_exp(portable_log(uniform()) * n_minus_1_inv);
+            return skip;
+        }
+        m_v_prime = portable_exp(portable_log(uniform()) * n_inv);
+    }
+}
+
+template <typename T>
+std::vector<T> Random::sample_distinct(
+        const size_t k,
+        const T min,
+        const T max,
+        const bool sorted)
+{
+    static_assert(std::is_integral_v<T> && sizeof(T) <= sizeof(uint64_t));
+    using U = std::make_unsigned_t<T>;
+    if (min > max) {
+        throw std::invalid_argument("min > max");
+    }
+    const uint64_t umin = static_cast<U>(min);
+    const uint64_t range = static_cast<U>(static_cast<U>(max) - static_cast<U>(min));
+    if (k != 0u && k - 1u > range) {
+        throw std::invalid_argument("k > max - min + 1");
+    }
+    // Offsets from min.
+    std::vector<uint64_t> offsets;
+    offsets.reserve(k);
+    if (k == 0u) {
+        // Nothing to do.
+    } else if (sorted && (range < 2 * k || range >= 64 * k) &&
+               range != std::numeric_limits<uint64_t>::max()) {
+        SortedSample sample = sorted_sample(k, range + 1u);
+        for (uint64_t i = 0; i < k; ++i) {
+            offsets.push_back(sample.next());
+        }
+    } else if (range < 2 * k) {
+        // Small range: partial Fisher-Yates.
+        std::vector<uint64_t> values(range + 1u);
+        for (uint64_t i = 0; i <= range; ++i) {
+            values[i] = i;
+        }
+        for (uint64_t i = 0; i < k; ++i) {
+            std::swap(values[i], values[uniform_uint64(i, range)]);
+        }
+        offsets.assign(values.begin(), values.begin() + k);
+    } else if (range < 64 * k) {
+        // Dense: Floyd's algorithm with a bitmap.
+        std::vector<uint64_t> bitmap(range / 64u + 1u);
+        for (uint64_t j = range + 1u - k; j <= range; ++j) {
+            uint64_t t = uniform_uint64(0, j);
+            if (bitmap[t / 64u] >> (t % 64u) & 1u) {
+                t = j;
+            }
+            bitmap[t / 64u] |= uint64_t{1} << (t % 64u);
+        }
+        for (uint64_t i = 0; i < bitmap.size(); ++i) {
+            for (uint64_t word = bitmap[i]; word != 0u; word &= word - 1u) {
+                offsets.push_back(64u * i + __builtin_ctzll(word));
+            }
+        }
+        if (!sorted) {
+            shuffle(offsets.begin(), offsets.end());
+        }
+    } else {
+        // Sparse: Floyd's algorithm with a hash set.
+        HashSet64 chosen(k);
+        // j goes from range + 1 - k to range; range + 1 may overflow.
+        for (uint64_t i = 0; i < k; ++i) {
+            const uint64_t j = range - (k - 1u - i);
+            uint64_t t = uniform_uint64(0, j);
+            if (!chosen.insert(t)) {
+                t = j;
+                chosen.insert(j);
+            }
+            offsets.push_back(t);
+        }
+        // Only the full 64-bit range gets here when sorted.
+        if (sorted) {
+            std::sort(offsets.begin(), offsets.end());
+        } else {
+            shuffle(offsets.begin(), offsets.end());
+        }
+    }
+
+    std::vector<T> result;
+    result.reserve(k);
+    for (const uint64_t offset : offsets) {
+        result.push_back(static_cast<T>(static_cast<U>(umin + offset)));
+    }
+    return result;
+}
+
+inline std::vector<int> Random::derangement(const int n) {
+    if (n < 0 || n == 1) {
+        throw std::invalid_argument("invalid n");
+    }
+    // Martinez, Panholzer, Prodinger. Generating random derangements.
+    //
+    // close_probability[u] = (u-1) D(u-2) / D(u), where D(u) is the number
+    // of derangements of u elements.
+    std::vector<double> close_probability(n + 1, 1.0);
+    // ratio = D(u-1) / D(u)
+    double ratio = 0.0;
+    for (int u = 3; u <= n; ++u) {
+        const double next_ratio = 1.0 / ((u - 1) * (1.0 + ratio));
+        close_probability[u] = (u - 1) * ratio * next_ratio;
+        ratio = next_ratio;
+    }
+
+    std::vector<int> p(n);
+    std::iota(p.begin(), p.end(), 0);
+    std::vector<bool> marked(n);
+    int unmarked = n;
+    for (int i = n - 1; unmarked >= 2; --i) {
+        if (marked[i]) {
+            continue;
+        }
+        int j;
+        do {
+            j = uniform_int(0, i - 1);
+        } while (marked[j]);
+        std::swap(p[i], p[j]);
+        if (uniform_real(0.0, 1.0) < close_probability[unmarked]) {
+            marked[j] = true;
+            --unmarked;
+        }
+        --unmarked;
+    }
+    return p;
+}
+
+inline std::vector<int> Random::cyclic_permutation(const int n) {
+    if (n < 0) {
+        throw std::invalid_argument("n < 0");
+    }
+    // Sattolo's algorithm.
+    std::vector<int> p(n);
+    std::iota(p.begin(), p.end(), 0);
+    for (int i = n - 1; i > 0; --i) {
+        std::swap(p[i], p[uniform_int(0, i - 1)]);
+    }
+    return p;
+}
+
+inline std::vector<int> Random::involution(const int n) {
+    if (n < 0) {
+        throw std::invalid_argument("n < 0");
+    }
+    // fixed_probability[m] = I(m-1) / I(m), where I(m) is the number of
+    // involutions of m elements: I(m) = I(m-1) + (m-1) I(m-2).
+    std::vector<double> fixed_probability(n + 1, 1.0);
+    for (int m = 2; m <= n; ++m) {
+        fixed_probability[m] = 1.0 / (1.0 + (m - 1) * fixed_probability[m - 1]);
+    }
+
+    std::vector<int> p(n);
+    std::vector<int> remaining(n);
+    std::iota(remaining.begin(), remaining.end(), 0);
+    for (int m = n; m > 0;) {
+        const int x = remaining[--m];
+        if (m == 0 || uniform_real(0.0, 1.0) < fixed_probability[m + 1]) {
+            p[x] = x;
+        } else {
+            const int j = uniform_int(0, m - 1);
+            const int y = remaining[j];
+            remaining[j] = remaining[--m];
+            p[x] = y;
+            p[y] = x;
+        }
+    }
+    return p;
+}
+
+inline std::vector<int> Random::permutation_with_cycles(const int n, const int k) {
+    if (n < 0 || k > n || (k < 1 && n > 0) || k < 0) {
+        throw std::invalid_argument("invalid n or k");
+    }
+    if (k == n) {
+        std::vector<int> p(n);
+        std::iota(p.begin(), p.end(), 0);
+        return p;
+    }
+    if (k == 1) {
+        return cyclic_permutation(n);
+    }
+
+    // Feller coupling: element i starts a new cycle with probability
+    // p_i = theta / (theta + i), otherwise it is inserted after one of the
+    // i earlier elements. All permutations with the same number of cycles
+    // are equally likely for any theta.
+    //
+    // Newton's method for theta with expected number of cycles k. The
+    // expectation is increasing and concave in theta, so the iterates
+    // increase to the root from theta = 0.
+    double theta = 0.0;
+    for (int iter = 0; iter < 100; ++iter) {
+        double expected = 1.0;
+        double derivative = 0.0;
+        for (int i = 1; i < n; ++i) {
+            const double denominator = theta + i;
+            expected += theta / denominator;
+            derivative += i / (denominator * denominator);
+        }
+        const double next_theta = theta + (k - expected) / derivative;
+        if (!(next_theta > theta)) {
+            break;
+        }
+        theta = next_theta;
+    }
+
+    std::vector<bool> new_cycle(n, true);
+    if (static_cast<double>(n - k) * (n - k) * 16.0 < n * std::sqrt(static_cast<double>(n))) {
+        // Few elements don't start a cycle. Element i doesn't with
+        // probability i / (theta + i), which decreases with i going down
+        // from n - 1: the next candidate comes after a geometric gap and is
+        // accepted with the ratio of the probabilities.
+        std::vector<int> non_starts;
+        do {
+            non_starts.clear();
+            for (int i = n - 1; i > 0 && non_starts.size() <= static_cast<size_t>(n - k);) {
+                const double probability = i / (theta + i);
+                const uint64_t skip = geometric(probability);
+                if (skip >= static_cast<uint64_t>(i)) {
+                    break;
+                }
+                const int j = i - static_cast<int>(skip);
+                i = j - 1;
+                if (skip != 0u && uniform_real(0.0, 1.0) >= j / (theta + j) / probability) {
+                    continue;
+                }
+                non_starts.push_back(j);
+            }
+        } while (non_starts.size() != static_cast<size_t>(n - k));
+        for (const int j : non_starts) {
+            new_cycle[j] = false;
+        }
+    } else {
+        // With q = p_{n-1}, element i >= 1 is an extra start with probability
+        // (p_i - q) / (1 - q) = theta (n - 1 - i) / ((theta + i) (n - 1)),
+        // and otherwise starts a cycle with probability q. Given m extra
+        // starts, the other k - 1 - m starts are a uniformly random subset of
+        // the other n - 1 - m elements, which has that size with probability
+        // f(m) = Binomial(n - 1 - m, q)(k - 1 - m). Accepting m with
+        // probability f(m) / max f conditions on k cycles.
+        const double q = theta / (theta + (n - 1));
+        // f(j + 1) / f(j), decreasing in j.
+        const auto ratio = [n, k, q](const int j) {
+            return static_cast<double>(k - 1 - j) / ((n - 1 - j) * q);
+        };
+        std::vector<int> extra_starts;
+        for (;;) {
+            extra_starts.clear();
+            // The probabilities decrease, so from i the next candidate comes
+            // after a geometric gap and is accepted with the ratio.
+            for (int i = 1; i < n - 1 && extra_starts.size() < static_cast<size_t>(k);) {
+                const double probability = theta * (n - 1 - i) / ((theta + i) * (n - 1));
+                const uint64_t skip = geometric(probability);
+                if (skip >= static_cast<uint64_t>(n - 1 - i)) {
+                    break;
+                }
+                const int j = i + static_cast<int>(skip);
+                i = j + 1;
+                if (skip != 0u &&
+                    uniform_real(0.0, 1.0) >=
+                        theta * (n - 1 - j) / ((theta + j) * (n - 1)) / probability) {
+                    continue;
+                }
+                extra_starts.push_back(j);
+            }
+            const int m = static_cast<int>(extra_starts.size());
+            if (m >= k) {
+                continue;
+            }
+            double acceptance = 1.0;
+            for (int j = m; j < k - 1 && ratio(j) >= 1.0; ++j) {
+                acceptance /= ratio(j);
+            }
+            for (int j = m; j > 0 && ratio(j - 1) < 1.0; --j) {
+                acceptance *= ratio(j - 1);
+            }
+            if (uniform_real(0.0, 1.0) < acceptance) {
+                break;
+            }
+        }
+
+        std::fill(new_cycle.begin() + 1, new_cycle.end(), false);
+        std::vector<int> rest;
+        size_t next_extra = 0;
+        for (int i = 1; i < n; ++i) {
+            if (next_extra < extra_starts.size() && extra_starts[next_extra] == i) {
+                new_cycle[i] = true;
+                ++next_extra;
+            } else {
+                rest.push_back(i);
+            }
+        }
+        const size_t num_other_starts = k - 1 - extra_starts.size();
+        if (num_other_starts != 0u) {
+            for (const size_t index : sample_distinct(num_other_starts, size_t{0}, rest.size() - 1u)) {
+                new_cycle[rest[index]] = true;
+            }
+        }
+    }
+
+    std::vector<int> p(n);
+    for (int i = 0; i < n; ++i) {
+        if (new_cycle[i]) {
+            p[i] = i;
+        } else {
+            const int j = uniform_int(0, i - 1);
+            p[i] = p[j];
+            p[j] = i;
+        }
+    }
+    return p;
+}
+
+template <typename T>
+std::vector<T> Random::composition(const T total, const size_t k, const T min_part) {
+    static_assert(std::is_integral_v<T> && sizeof(T) <= sizeof(uint64_t));
+    std::vector<T> parts;
+    if (k == 0u) {
+        if (total != 0) {
+            throw std::invalid_argument("k = 0 with nonzero total");
+        }
+        return parts;
+    }
+    // Distribute rest = total - k * min_part among k parts >= 0: the bars
+    // are k-1 of rest + k - 1 positions.
+    const __int128 rest = static_cast<__int128>(total) - static_cast<__int128>(k) * min_part;
+    if (rest < 0) {
+        throw std::invalid_argument("total < k * min_part");
+    }
+    if (rest + (k - 1u) > std::numeric_limits<uint64_t>::max()) {
+        throw std::invalid_argument("total too large");
+    }
+    const uint64_t num_positions = static_cast<uint64_t>(rest) + (k - 1u);
+    parts.reserve(k);
+    uint64_t previous = 0;
+    const auto add_part = [&](const uint64_t bar) {
+        parts.push_back(static_cast<T>(static_cast<__int128>(bar - previous) + min_part));
+        previous = bar + 1u;
+    };
+    if (k > 1u) {
+        SortedSample bars = sorted_sample(k - 1u, num_positions);
+        while (bars.remaining() != 0u) {
+            add_part(bars.next());
+        }
+    }
+    add_part(num_positions);
+    return parts;
+}
+
+inline std::vector<uint64_t> Random::integer_partition(const uint64_t n) {
+    std::vector<uint64_t> parts;
+    if (n == 0u) {
+        return parts;
+    }
+    // Boltzmann parameter x = exp(-c) makes the expected size n.
+    constexpr double pi = 3.14159265358979323846;
+    const double c = pi / portable_sqrt(6.0 * static_cast<double>(n));
+    // (part, multiplicity) for parts >= 2, increasing.
+    std::vector<std::pair<uint64_t, uint64_t>> multiplicities;
+    // Sum of parts >= 2.
+    uint64_t size;
+    for (;;) {
+        multiplicities.clear();
+        size = 0;
+        // Part j is present with probability x^j. Thinning: candidates
+        // come with probability x^(i+1) >= x^j for j > i and are accepted
+        // with probability x^(j-i-1).
+        for (uint64_t i = 1; ;) {
+            const double bound = portable_exp(-c * static_cast<double>(i + 1u));
+            if (bound == 0.0) {
+                break;
+            }
+            const uint64_t skip = geometric(bound);
+            if (skip >= n - i) {
+                break;
+            }
+            const uint64_t j = i + 1u + skip;
+            i = j;
+            if (skip != 0u &&
+                uniform_real(0.0, 1.0) >= portable_exp(-c * static_cast<double>(skip))) {
+                continue;
+            }
+            // Given at least one, the multiplicity is 1 + geometric(1 - x^j).
+            const uint64_t count =
+                1u + geometric(1.0 - portable_exp(-c * static_cast<double>(j)));
+            if (count > (n - size) / j) {
+                size = n + 1u;
+                break;
+            }
+            size += count * j;
+            multiplicities.emplace_back(j, count);
+        }
+        if (size > n) {
+            continue;
+        }
+        // The multiplicity of 1 is geometric(1 - x). Accept n - size with
+        // probability P(n - size) / P(0) = x^(n - size).
+        if (uniform_real(0.0, 1.0) < portable_exp(-c * static_cast<double>(n - size))) {
+            break;
+        }
+    }
+    for (auto it = multiplicities.rbegin(); it != multiplicities.rend(); ++it) {
+        parts.insert(parts.end(), it->second, it->first);
+    }
+    parts.insert(parts.end(), n - size, 1u);
+    return parts;
+}
+
+inline Montgomery64::Montgomery64(const uint64_t n) : m_n(n) {
+    if (n % 2u == 0u || n == 1u) {
+        throw std::invalid_argument("Montgomery modulus must be odd and > 1");
+    }
+    // Newton's iteration doubles the number of correct low bits; n is
+    // its own inverse mod 8.
+    uint64_t inverse = n;
+    for (int i = 0; i < 5; ++i) {
+        inverse *= 2u - n * inverse;
+    }
+    m_neg_inverse = 0u - inverse;
+    m_one = (0u - n) % n;
+}
+
+inline uint64_t Montgomery64::to_montgomery(const uint64_t x) const {
+    return static_cast<uint64_t>(static_cast<unsigned __int128>(x) * m_one % m_n);
+}
+
+inline uint64_t Montgomery64::reduce(const unsigned __int128 t) const {
+    const uint64_t m = static_cast<uint64_t>(t) * m_neg_inverse;
+    // t + m n is divisible by 2^64 and may overflow 128 bits.
+    const unsigned __int128 mn = static_cast<unsigned __int128>(m) * m_n;
+    const uint64_t high = static_cast<uint64_t>(t >> 64) + static_cast<uint64_t>(mn >> 64) +
+                          (static_cast<uint64_t>(t) != 0u);
+    const uint64_t carry = high < static_cast<uint64_t>(t >> 64);
+    return carry || high >= m_n ? high - m_n : high;
+}
+
+constexpr array<uint8_t, 12> small_primes = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+
+constexpr array<uint64_t, 7> miller_rabin_bases = {
+    2, 325, 9375, 28178, 450775, 9780504, 1795265022};
+
+// Returns 0 if n is composite by trial division, 1 if prime, 2 if unknown.
+inline int trial_division(const uint64_t n) {
+    for (const uint64_t p : small_primes) {
+        if (n % p == 0u) {
+            return n == p;
+        }
+    }
+    return n < 37u * 37u ? n >= 2u : 2;
+}
+
+template <size_t... lanes>
+std::array<Montgomery64, sizeof...(lanes)> make_montgomery(
+        const uint64_t *const n, std::index_sequence<lanes...>) {
+    return {Montgomery64(n[lanes])...};
+}
+
+// Miller-Rabin with miller_rabin_bases[first_base, last_base) on num_lanes
+// numbers n > 37^2 without small factors, in lockstep.
+template <size_t num_lanes>
+void miller_rabin(const uint64_t *const n, bool *const result,
+                  const size_t first_base, const size_t last_base) {
+    const std::array<Montgomery64, num_lanes> mont =
+        make_montgomery(n, std::make_index_sequence<num_lanes>());
+    uint64_t d[num_lanes];
+    int s[num_lanes];
+    uint64_t minus_one[num_lanes];
+    uint64_t max_d = 0;
+    for (size_t i = 0; i < num_lanes; ++i) {
+        s[i] = __builtin_ctzll(n[i] - 1u);
+        d[i] = (n[i] - 1u) >> s[i];
+        minus_one[i] = n[i] - mont[i].one();
+        max_d = std::max(max_d, d[i]);
+        result[i] = true;
+    }
+    for (size_t base_index = first_base; base_index < last_base; ++base_index) {
+        const uint64_t base = miller_rabin_bases[base_index];
+        uint64_t b[num_lanes];
+        uint64_t x[num_lanes];
+        for (size_t i = 0; i < num_lanes; ++i) {
+            // A base divisible by n proves nothing; 1 passes.
+            b[i] = base % n[i] == 0u ? mont[i].one() : mont[i].to_montgomery(base);
+            x[i] = mont[i].one();
+        }
+        // x = b^d. With several lanes, branch-free so that the lanes'
+        // multiplications overlap.
+        for (int bit = 63 - __builtin_clzll(max_d); bit >= 0; --bit) {
+            for (size_t i = 0; i < num_lanes; ++i) {
+                x[i] = mont[i].multiply(x[i], x[i]);
+                if (num_lanes == 1u) {
+                    if ((d[i] >> bit) & 1u) {
+                        x[i] = mont[i].multiply(x[i], b[i]);
+                    }
+                } else {
+                    const uint64_t y = mont[i].multiply(x[i], b[i]);
+                    x[i] = (d[i] >> bit) & 1u ? y : x[i];
+                }
+            }
+        }
+        bool any_probable_prime = false;
+        for (size_t i = 0; i < num_lanes; ++i) {
+            if (result[i] && x[i] != mont[i].one() && x[i] != minus_one[i]) {
+                bool witness = true;
+                for (int j = 1; j < s[i] && witness; ++j) {
+                    x[i] = mont[i].multiply(x[i], x[i]);
+                    witness = x[i] != minus_one[i];
+                }
+                result[i] = !witness;
+            }
+            any_probable_prime |= result[i];
+        }
+        if (!any_probable_prime) {
+            break;
+        }
+    }
+}
+
+inline bool is_prime(const uint64_t n) {
+    const int known = trial_division(n);
+    if (known != 2) {
+        return known;
+    }
+    bool result;
+    miller_rabin<1>(&n, &result, 0, miller_rabin_bases.size());
+    return result;
+}
+
+template <typename Iter, typename OutIter>
+void is_prime(Iter begin, const Iter end, OutIter out) {
+    constexpr size_t num_lanes = 4;
+    // Batches of numbers waiting for the first Miller-Rabin base, and of
+    // the rare ones that pass it and wait for the rest.
+    struct Batch {
+        uint64_t n[num_lanes];
+        OutIter out[num_lanes];
+        bool result[num_lanes];
+        size_t size = 0;
+    };
+    Batch first;
+    Batch rest;
+    const auto run_rest = [&] {
+        miller_rabin<num_lanes>(rest.n, rest.result, 1, miller_rabin_bases.size());
+        for (size_t i = 0; i < num_lanes; ++i) {
+            *rest.out[i] = rest.result[i];
+        }
+        rest.size = 0;
+    };
+    for (; begin != end; ++begin, ++out) {
+        const uint64_t n = *begin;
+        const int known = trial_division(n);
+        if (known != 2) {
+            *out = known;
+            continue;
+        }
+        first.n[first.size] = n;
+        first.out[first.size] = out;
+        if (++first.size != num_lanes) {
+            continue;
+        }
+        miller_rabin<num_lanes>(first.n, first.result, 0, 1);
+        for (size_t i = 0; i < num_lanes; ++i) {
+            if (!first.result[i]) {
+                *first.out[i] = false;
+                continue;
+            }
+            rest.n[rest.size] = first.n[i];
+            rest.out[rest.size] = first.out[i];
+            if (++rest.size == num_lanes) {
+                run_rest();
+            }
+        }
+        first.size = 0;
+    }
+    for (size_t i = 0; i < first.size; ++i) {
+        *first.out[i] = is_prime(first.n[i]);
+    }
+    for (size_t i = 0; i < rest.size; ++i) {
+        miller_rabin<1>(&rest.n[i], &rest.result[i], 1, miller_rabin_bases.size());
+        *rest.out[i] = rest.result[i];
+    }
+}
+
+// Binary GCD.
+inline uint64_t gcd(uint64_t a, uint64_t b) {
+    if (a == 0u || b == 0u) {
+        return a | b;
+    }
+    const int shift = __builtin_ctzll(a | b);
+    a >>= __builtin_ctzll(a);
+    do {
+        b >>= __builtin_ctzll(b);
+        if (a > b) {
+            std::swap(a, b);
+        }
+        b -= a;
+    } while (b != 0u);
+    return a << shift;
+}
+
+inline uint64_t Random::prime(const uint64_t min, const uint64_t max) {
+    if (min > max) {
+        throw std::invalid_argument("min > max");
+    }
+    // Gaps between consecutive primes below 2^64 are less than 1600, so
+    // longer ranges contain primes. Short ones are enumerated.
+    if (max - min < 4096u) {
+        std::vector<uint64_t> candidates(max - min + 1u);
+        std::iota(candidates.begin(), candidates.end(), min);
+        std::vector<uint8_t> prime_flags(candidates.size());
+        is_prime(candidates.begin(), candidates.end(), prime_flags.begin());
+        std::vector<uint64_t> primes;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            if (prime_flags[i]) {
+                primes.push_back(candidates[i]);
+            }
+        }
+        if (primes.empty()) {
+            throw std::invalid_argument("no prime in range");
+        }
+        return primes[uniform_uint64(0, primes.size() - 1u)];
+    }
+    for (;;) {
+        const uint64_t n = uniform_uint64(min, max);
+        if (is_prime(n)) {
+            return n;
+        }
+    }
+}
+
+inline std::pair<uint64_t, uint64_t> Random::coprime_pair(const uint64_t min, const uint64_t max) {
+    const std::vector<uint64_t> tuple = coprime_tuple(2, min, max);
+    return {tuple[0], tuple[1]};
+}
+
+inline std::vector<uint64_t> Random::coprime_tuple(const size_t k, const uint64_t min,
+                                                   const uint64_t max) {
+    if (min > max) {
+        throw std::invalid_argument("min > max");
+    }
+    // Two consecutive integers are coprime.
+    const bool one_in_range = min <= 1u && max >= 1u;
+    if (k == 0u || (!one_in_range && (k == 1u || min == max))) {
+        throw std::invalid_argument("no coprime tuple");
+    }
+    // gcd(x) = x, so the only 1-tuple is {1}.
+    if (k == 1u) {
+        return {1};
+    }
+    // Rejection. The acceptance probability is at least about
+    // 1 / zeta(k) >= 6 / pi^2 for large ranges.
+    std::vector<uint64_t> tuple(k);
+    for (;;) {
+        uint64_t g = 0;
+        for (uint64_t &x : tuple) {
+            x = uniform_uint64(min, max);
+            g = gcd(g, x);
+        }
+        if (g == 1u) {
+            return tuple;
+        }
+    }
+}
+
 } // namespace random
 
+#if defined(__clang__)
+#pragma float_control(pop)
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+using random_private::DiscreteDistribution;
+using random_private::Montgomery64;
 using random_private::Random;
+using random_private::SortedSample;
+using random_private::StringTable;
+using random_private::UniformIntDistribution;
+using random_private::is_prime;
 
 #endif
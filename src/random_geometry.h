@@ -0,0 +1,243 @@
+// Random geometry: sets of lattice points and convex polygons.
+//
+// Points lie in the box [xmin, xmax] x [ymin, ymax].
+
+#ifndef RANDOM_GEOMETRY_H
+#define RANDOM_GEOMETRY_H
+
+#include "random.h"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace random_private {
+
+struct Point {
+    int64_t x;
+    int64_t y;
+};
+
+// k distinct points, all k-subsets of the box equally likely, in random
+// order. The box may have at most 2^64 points. O(k).
+std::vector<Point> distinct_points(Random &random, size_t k,
+                                   int64_t xmin, int64_t xmax,
+                                   int64_t ymin, int64_t ymax);
+
+// k random points, no three collinear, in random order.
+//
+// The points are (x, (a x^2 + b x + c) mod p) for k distinct random x in
+// [0, p) and random a != 0, b, c, shifted into the box, where p is the
+// largest prime <= min(width, height, 2^31). A line meets the parabola
+// mod p in at most 2 points. Not uniform among all such sets. O(k).
+std::vector<Point> general_position_points(Random &random, size_t k,
+                                           int64_t xmin, int64_t xmax,
+                                           int64_t ymin, int64_t ymax);
+
+// Random strictly convex polygon with n >= 3 vertices in counterclockwise
+// order.
+//
+// Valtr's algorithm: random x and y coordinates are split into two chains
+// each, the edge vectors they give are paired randomly and sorted by
+// angle. Parallel edges are merged, which is common for lattice vectors,
+// so more vectors are generated when needed and a random n of the
+// resulting vertices are kept. Throws std::runtime_error if there are still
+// too few, which happens when the box is too small for n vertices.
+// O(n log n) expected.
+std::vector<Point> convex_polygon(Random &random, size_t n,
+                                  int64_t xmin, int64_t xmax,
+                                  int64_t ymin, int64_t ymax);
+
+// Number of integers in [min, max].
+inline uint64_t range_size(const int64_t min, const int64_t max) {
+    if (min > max) {
+        throw std::invalid_argument("min > max");
+    }
+    return static_cast<uint64_t>(max) - static_cast<uint64_t>(min) + 1u;
+}
+
+inline std::vector<Point> distinct_points(Random &random, const size_t k,
+                                          const int64_t xmin, const int64_t xmax,
+                                          const int64_t ymin, const int64_t ymax) {
+    const uint64_t width = range_size(xmin, xmax);
+    const uint64_t height = range_size(ymin, ymax);
+    // width or height 0 means 2^64.
+    const unsigned __int128 num_points =
+        static_cast<unsigned __int128>(width != 0u ? width : ~uint64_t{0}) *
+        (height != 0u ? height : ~uint64_t{0});
+    if (width == 0u || height == 0u || num_points > (static_cast<unsigned __int128>(1) << 64)) {
+        throw std::invalid_argument("box too large");
+    }
+    if (k > num_points) {
+        throw std::invalid_argument("k too large");
+    }
+    std::vector<Point> points;
+    if (k == 0u) {
+        return points;
+    }
+    const std::vector<uint64_t> indices = random.sample_distinct<uint64_t>(
+        k, 0, static_cast<uint64_t>(num_points - 1u));
+    points.reserve(k);
+    for (const uint64_t index : indices) {
+        points.push_back({static_cast<int64_t>(static_cast<uint64_t>(xmin) + index % width),
+                          static_cast<int64_t>(static_cast<uint64_t>(ymin) + index / width)});
+    }
+    return points;
+}
+
+inline std::vector<Point> general_position_points(Random &random, const size_t k,
+                                                  const int64_t xmin, const int64_t xmax,
+                                                  const int64_t ymin, const int64_t ymax) {
+    if (k <= 2u) {
+        return distinct_points(random, k, xmin, xmax, ymin, ymax);
+    }
+    const uint64_t width = range_size(xmin, xmax);
+    const uint64_t height = range_size(ymin, ymax);
+    uint64_t limit = uint64_t{1} << 31;
+    for (const uint64_t size : {width, height}) {
+        if (size != 0u) {
+            limit = std::min(limit, size);
+        }
+    }
+    uint32_t p = static_cast<uint32_t>(limit);
+    while (p >= 2u && !is_prime(p)) {
+        --p;
+    }
+    if (k > p) {
+        throw std::invalid_argument("box too small");
+    }
+    std::vector<Point> points;
+    const uint64_t a = random.uniform_uint64(1, p - 1u);
+    const uint64_t b = random.uniform_uint64(0, p - 1u);
+    const uint64_t c = random.uniform_uint64(0, p - 1u);
+    const std::vector<uint64_t> xs = random.sample_distinct<uint64_t>(k, 0, p - 1u);
+    points.reserve(k);
+    for (const uint64_t x : xs) {
+        const uint64_t y = ((a * x % p) * x + b * x + c) % p;
+        points.push_back({static_cast<int64_t>(static_cast<uint64_t>(xmin) + x),
+                          static_cast<int64_t>(static_cast<uint64_t>(ymin) + y)});
+    }
+    return points;
+}
+
+// Valtr: differences between consecutive sorted coordinates, with each
+// interior coordinate assigned to one of two chains from min to max.
+// The differences sum to 0.
+inline std::vector<int64_t> valtr_components(Random &random, const size_t n,
+                                             const int64_t min, const int64_t max,
+                                             int64_t &smallest) {
+    const std::vector<int64_t> values = random.sample_distinct<int64_t>(n, min, max, true);
+    smallest = values.front();
+    std::vector<int64_t> components;
+    components.reserve(n);
+    int64_t last_top = values.front();
+    int64_t last_bottom = values.front();
+    // The top chain is traversed from min to max, the bottom one back.
+    for (size_t i = 1; i + 1 < n; ++i) {
+        if (random.bits(1)) {
+            components.push_back(values[i] - last_top);
+            last_top = values[i];
+        } else {
+            components.push_back(last_bottom - values[i]);
+            last_bottom = values[i];
+        }
+    }
+    components.push_back(values.back() - last_top);
+    components.push_back(last_bottom - values.back());
+    return components;
+}
+
+inline std::vector<Point> convex_polygon(Random &random, const size_t n,
+                                         const int64_t xmin, const int64_t xmax,
+                                         const int64_t ymin, const int64_t ymax) {
+    if (n < 3u) {
+        throw std::invalid_argument("n < 3");
+    }
+    // Differences of coordinates must fit in int64_t.
+    const uint64_t width = range_size(xmin, xmax);
+    const uint64_t height = range_size(ymin, ymax);
+    if (width == 0u || width > uint64_t{1} << 62 || height == 0u || height > uint64_t{1} << 62) {
+        throw std::invalid_argument("box too large");
+    }
+    if (n > width || n > height) {
+        throw std::invalid_argument("box too small");
+    }
+    // Counterclockwise order from angle -pi.
+    const auto angle_less = [](const Point &a, const Point &b) {
+        const bool upper_a = a.y > 0 || (a.y == 0 && a.x > 0);
+        const bool upper_b = b.y > 0 || (b.y == 0 && b.x > 0);
+        if (upper_a != upper_b) {
+            return upper_b;
+        }
+        return static_cast<__int128>(a.x) * b.y > static_cast<__int128>(a.y) * b.x;
+    };
+    const auto parallel = [](const Point &a, const Point &b) {
+        return static_cast<__int128>(a.x) * b.y == static_cast<__int128>(a.y) * b.x &&
+               (a.x > 0) == (b.x > 0) && (a.y > 0) == (b.y > 0);
+    };
+
+    // Number of vectors to generate. Grows when merging loses too many.
+    const uint64_t max_num_vectors = std::min(width, height);
+    size_t num_vectors = n;
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        int64_t x0;
+        int64_t y0;
+        const std::vector<int64_t> dx = valtr_components(random, num_vectors, xmin, xmax, x0);
+        std::vector<int64_t> dy = valtr_components(random, num_vectors, ymin, ymax, y0);
+        random.shuffle(dy.begin(), dy.end());
+        std::vector<Point> edges(num_vectors);
+        for (size_t i = 0; i < num_vectors; ++i) {
+            edges[i] = {dx[i], dy[i]};
+        }
+        std::sort(edges.begin(), edges.end(), angle_less);
+
+        // Merge parallel edges.
+        size_t num_edges = 0;
+        for (const Point &edge : edges) {
+            if (num_edges != 0u && parallel(edges[num_edges - 1u], edge)) {
+                edges[num_edges - 1u].x += edge.x;
+                edges[num_edges - 1u].y += edge.y;
+            } else {
+                edges[num_edges++] = edge;
+            }
+        }
+        if (num_edges < n) {
+            num_vectors = std::min<uint64_t>(max_num_vectors, num_vectors + 2u * (n - num_edges));
+            continue;
+        }
+
+        // Lay the edges end to end and move the polygon so that its
+        // bounding box starts at the smallest sampled coordinates. Then
+        // keep a random n of the vertices, which are still strictly convex.
+        const std::vector<size_t> kept = random.sample_distinct<size_t>(n, 0, num_edges - 1u, true);
+        std::vector<Point> polygon;
+        polygon.reserve(n);
+        Point current = {0, 0};
+        Point low = {0, 0};
+        for (size_t i = 0, j = 0; i < num_edges; ++i) {
+            if (j < n && kept[j] == i) {
+                polygon.push_back(current);
+                ++j;
+            }
+            low.x = std::min(low.x, current.x);
+            low.y = std::min(low.y, current.y);
+            current.x += edges[i].x;
+            current.y += edges[i].y;
+        }
+        for (Point &point : polygon) {
+            point.x += x0 - low.x;
+            point.y += y0 - low.y;
+        }
+        return polygon;
+    }
+    throw std::runtime_error("convex_polygon: too many attempts");
+}
+
+} // namespace random_private
+
+using random_private::Point;
+using random_private::convex_polygon;
+using random_private::distinct_points;
+using random_private::general_position_points;
+
+#endif
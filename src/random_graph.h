@@ -0,0 +1,493 @@
+// Random graphs.
+//
+// Vertices are 0, ..., n-1. Graphs are returned as lists of edges, without
+// self-loops or duplicate edges. Undirected edges may have either
+// orientation.
+
+#ifndef RANDOM_GRAPH_H
+#define RANDOM_GRAPH_H
+
+#include "random.h"
+#include "random_tree.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace random_private {
+
+// Number of possible edges on n vertices.
+uint64_t num_possible_edges(int n, bool directed);
+
+// Edge with the given index in [0, num_possible_edges(n, directed)).
+//
+// Undirected: edges {u, v} with u > v are indexed u(u-1)/2 + v.
+// Directed: edges (u, v) are indexed in lexicographic order.
+Edge edge_from_index(uint64_t index, int n, bool directed);
+
+// Uniformly random graph with exactly m edges, in random order.
+// O(m) time and memory.
+std::vector<Edge> gnm_graph(Random &random, int n, uint64_t m, bool directed = false);
+
+// Each possible edge present independently with probability p, in index
+// order. O(n + number of edges) expected time.
+std::vector<Edge> gnp_graph(Random &random, int n, double p, bool directed = false);
+
+// Random connected undirected graph with m edges, n-1 <= m: a uniformly
+// random spanning tree plus m-n+1 distinct other edges, in random order.
+//
+// Not uniform among connected graphs. O(n log n + m).
+std::vector<Edge> connected_graph(Random &random, int n, uint64_t m);
+
+// Directed acyclic graph with m edges: G(n, m) edges oriented along a
+// hidden, uniformly random topological order.
+//
+// Not uniform among DAGs: those with many topological orders are more
+// likely. O(n + m).
+std::vector<Edge> dag(Random &random, int n, uint64_t m);
+
+// Uniformly random bipartite graph with m edges between parts
+// 0, ..., n1-1 and n1, ..., n1+n2-1, in random order. Use relabel to hide
+// the parts. O(m).
+std::vector<Edge> bipartite_graph(Random &random, int n1, int n2, uint64_t m);
+
+// Adjacency lists in compressed sparse row form. The neighbors of v are
+// targets[offsets[v]], ..., targets[offsets[v+1]-1].
+struct AdjacencyGraph {
+    std::vector<int> offsets;
+    std::vector<int> targets;
+
+    int num_vertices() const { return static_cast<int>(offsets.size()) - 1; }
+};
+
+// Undirected edges are stored in both directions. O(n + m).
+AdjacencyGraph adjacency_graph(int n, const std::vector<Edge> &edges,
+                               bool directed = false);
+
+// rows x cols grid. Vertex (r, c) is r * cols + c.
+std::vector<Edge> grid_graph(int rows, int cols);
+
+// Uniformly random spanning tree of a connected undirected graph.
+//
+// Wilson's algorithm: loop-erased random walks to the growing tree.
+// Expected time is the mean hitting time of the random walk, e.g.
+// O(n log n) for grids.
+std::vector<Edge> uniform_spanning_tree(Random &random, const AdjacencyGraph &graph);
+
+// Uniformly random simple graph in which vertex v has degree degrees[v].
+//
+// Configuration model: pairs up degree stubs at random, restarting as soon
+// as a self-loop or duplicate edge appears. Practical only for small
+// degrees: the expected number of attempts grows like exp(c^2 / 4), where
+// c = sum d(d-1) / sum d. Throws std::runtime_error after max_attempts.
+std::vector<Edge> configuration_model(Random &random, const std::vector<int> &degrees,
+                                      int max_attempts = 1000);
+
+// Random simple graph in which vertex v has degree degrees[v].
+//
+// Havel-Hakimi construction, then num_switches random double edge swaps
+// (ab, cd -> ad, cb). Approximately uniform when num_switches is a large
+// multiple of the number of edges. Throws std::invalid_argument if there
+// is no such graph. O(n log n + m + num_switches) expected time.
+std::vector<Edge> degree_sequence_graph(Random &random, const std::vector<int> &degrees,
+                                        uint64_t num_switches);
+
+inline uint64_t num_possible_edges(const int n, const bool directed) {
+    if (n < 0) {
+        throw std::invalid_argument("n < 0");
+    }
+    const uint64_t pairs = static_cast<uint64_t>(n) * (n - (n > 0));
+    return directed ? pairs : pairs / 2u;
+}
+
+inline Edge edge_from_index(const uint64_t index, const int n, const bool directed) {
+    if (directed) {
+        const int u = static_cast<int>(index / (n - 1u));
+        const int v = static_cast<int>(index % (n - 1u));
+        return {u, v + (v >= u)};
+    }
+    // Approximate inverse of u(u-1)/2, then fix rounding errors.
+    uint64_t u = static_cast<uint64_t>(std::sqrt(2.0 * index + 0.25) + 0.5);
+    while (u * (u - 1u) / 2u > index) {
+        --u;
+    }
+    while ((u + 1u) * u / 2u <= index) {
+        ++u;
+    }
+    return {static_cast<int>(u), static_cast<int>(index - u * (u - 1u) / 2u)};
+}
+
+inline std::vector<Edge> gnm_graph(Random &random, const int n, const uint64_t m,
+                                   const bool directed) {
+    const uint64_t num_possible = num_possible_edges(n, directed);
+    if (m > num_possible) {
+        throw std::invalid_argument("m too large");
+    }
+    std::vector<Edge> edges;
+    if (m == 0u) {
+        return edges;
+    }
+    const std::vector<uint64_t> indices =
+        random.sample_distinct<uint64_t>(m, 0, num_possible - 1u);
+    edges.reserve(m);
+    for (const uint64_t index : indices) {
+        Edge edge = edge_from_index(index, n, directed);
+        if (!directed && random.bits(1)) {
+            std::swap(edge.u, edge.v);
+        }
+        edges.push_back(edge);
+    }
+    return edges;
+}
+
+inline std::vector<Edge> gnp_graph(Random &random, const int n, const double p,
+                                   const bool directed) {
+    if (!(p >= 0.0 && p <= 1.0)) {
+        throw std::invalid_argument("p out of range");
+    }
+    const uint64_t num_possible = num_possible_edges(n, directed);
+    std::vector<Edge> edges;
+    if (p == 0.0) {
+        return edges;
+    }
+    // Geometric skipping: the gap to the next edge is geometric(p).
+    for (uint64_t index = random.geometric(p); index < num_possible;) {
+        edges.push_back(edge_from_index(index, n, directed));
+        const uint64_t skip = random.geometric(p);
+        if (skip >= num_possible - index) {
+            break;
+        }
+        index += skip + 1u;
+    }
+    return edges;
+}
+
+inline std::vector<Edge> connected_graph(Random &random, const int n, const uint64_t m) {
+    const uint64_t num_possible = num_possible_edges(n, false);
+    if (m > num_possible || (n > 0 && m < n - 1u)) {
+        throw std::invalid_argument("m out of range");
+    }
+    std::vector<Edge> edges = random_tree(random, n);
+    const uint64_t num_extra = m - edges.size();
+    if (num_extra != 0u) {
+        std::vector<uint64_t> tree_indices;
+        tree_indices.reserve(edges.size());
+        for (const Edge &edge : edges) {
+            const auto [v, u] = std::minmax(edge.u, edge.v);
+            tree_indices.push_back(static_cast<uint64_t>(u) * (u - 1u) / 2u + v);
+        }
+        std::sort(tree_indices.begin(), tree_indices.end());
+        // Ranks among the non-tree edges, mapped to indices by skipping
+        // over tree edges.
+        const std::vector<uint64_t> ranks = random.sample_distinct<uint64_t>(
+            num_extra, 0, num_possible - tree_indices.size() - 1u, true);
+        size_t num_skipped = 0;
+        for (const uint64_t rank : ranks) {
+            while (num_skipped < tree_indices.size() &&
+                   tree_indices[num_skipped] <= rank + num_skipped) {
+                ++num_skipped;
+            }
+            edges.push_back(edge_from_index(rank + num_skipped, n, false));
+        }
+    }
+    relabel(random, n, edges);
+    return edges;
+}
+
+inline std::vector<Edge> dag(Random &random, const int n, const uint64_t m) {
+    std::vector<Edge> edges = gnm_graph(random, n, m);
+    std::vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    random.shuffle(order.begin(), order.end());
+    for (Edge &edge : edges) {
+        if (edge.u > edge.v) {
+            std::swap(edge.u, edge.v);
+        }
+        edge.u = order[edge.u];
+        edge.v = order[edge.v];
+    }
+    return edges;
+}
+
+inline std::vector<Edge> bipartite_graph(Random &random, const int n1, const int n2,
+                                         const uint64_t m) {
+    if (n1 < 0 || n2 < 0) {
+        throw std::invalid_argument("negative part size");
+    }
+    const uint64_t num_possible = static_cast<uint64_t>(n1) * n2;
+    if (m > num_possible) {
+        throw std::invalid_argument("m too large");
+    }
+    std::vector<Edge> edges;
+    if (m == 0u) {
+        return edges;
+    }
+    const std::vector<uint64_t> indices =
+        random.sample_distinct<uint64_t>(m, 0, num_possible - 1u);
+    edges.reserve(m);
+    for (const uint64_t index : indices) {
+        edges.push_back({static_cast<int>(index / n2), n1 + static_cast<int>(index % n2)});
+    }
+    return edges;
+}
+
+inline AdjacencyGraph adjacency_graph(const int n, const std::vector<Edge> &edges,
+                                      const bool directed) {
+    if (n < 0) {
+        throw std::invalid_argument("n < 0");
+    }
+    AdjacencyGraph graph;
+    graph.offsets.assign(n + 2, 0);
+    // Count into offsets[v + 2], prefix sums, then fill using offsets[v + 1]
+    // as the insertion point, which leaves offsets[v + 1] at the end of v.
+    for (const Edge &edge : edges) {
+        if (edge.u < 0 || edge.u >= n || edge.v < 0 || edge.v >= n) {
+            throw std::invalid_argument("vertex out of range");
+        }
+        ++graph.offsets[edge.u + 2];
+        if (!directed) {
+            ++graph.offsets[edge.v + 2];
+        }
+    }
+    std::partial_sum(graph.offsets.begin(), graph.offsets.end(), graph.offsets.begin());
+    graph.targets.resize(graph.offsets.back());
+    for (const Edge &edge : edges) {
+        graph.targets[graph.offsets[edge.u + 1]++] = edge.v;
+        if (!directed) {
+            graph.targets[graph.offsets[edge.v + 1]++] = edge.u;
+        }
+    }
+    graph.offsets.pop_back();
+    return graph;
+}
+
+inline std::vector<Edge> grid_graph(const int rows, const int cols) {
+    if (rows < 0 || cols < 0) {
+        throw std::invalid_argument("negative size");
+    }
+    std::vector<Edge> edges;
+    for (int r = 0; r < rows; ++r) {
+        for (int c = 0; c < cols; ++c) {
+            const int v = r * cols + c;
+            if (c + 1 < cols) {
+                edges.push_back({v, v + 1});
+            }
+            if (r + 1 < rows) {
+                edges.push_back({v, v + cols});
+            }
+        }
+    }
+    return edges;
+}
+
+inline std::vector<Edge> uniform_spanning_tree(Random &random, const AdjacencyGraph &graph) {
+    const int n = graph.num_vertices();
+    std::vector<Edge> edges;
+    if (n <= 0) {
+        return edges;
+    }
+    // The walks only terminate if the graph is connected.
+    std::vector<bool> in_tree(n);
+    {
+        std::vector<int> stack = {0};
+        in_tree[0] = true;
+        int num_reached = 1;
+        while (!stack.empty()) {
+            const int v = stack.back();
+            stack.pop_back();
+            for (int i = graph.offsets[v]; i < graph.offsets[v + 1]; ++i) {
+                const int w = graph.targets[i];
+                if (!in_tree[w]) {
+                    in_tree[w] = true;
+                    ++num_reached;
+                    stack.push_back(w);
+                }
+            }
+        }
+        if (num_reached != n) {
+            throw std::invalid_argument("graph not connected");
+        }
+        in_tree.assign(n, false);
+    }
+
+    edges.reserve(n - 1);
+    std::vector<int> next(n);
+    in_tree[random.uniform_int(0, n - 1)] = true;
+    for (int start = 0; start < n; ++start) {
+        // Random walk until the tree is hit, remembering the last exit from
+        // each vertex, which erases loops.
+        for (int v = start; !in_tree[v];) {
+            const int begin = graph.offsets[v];
+            const int degree = graph.offsets[v + 1] - begin;
+            next[v] = graph.targets[begin + random.uniform_int(0, degree - 1)];
+            v = next[v];
+        }
+        for (int v = start; !in_tree[v]; v = next[v]) {
+            in_tree[v] = true;
+            edges.push_back({v, next[v]});
+        }
+    }
+    return edges;
+}
+
+// Number of edges with these degrees.
+inline uint64_t num_edges_from_degrees(const std::vector<int> &degrees) {
+    uint64_t sum = 0;
+    for (const int d : degrees) {
+        if (d < 0 || static_cast<size_t>(d) >= degrees.size()) {
+            throw std::invalid_argument("degree out of range");
+        }
+        sum += d;
+    }
+    if (sum % 2u != 0u) {
+        throw std::invalid_argument("odd degree sum");
+    }
+    return sum / 2u;
+}
+
+inline uint64_t edge_key(const int n, const int u, const int v) {
+    const auto [a, b] = std::minmax(u, v);
+    return static_cast<uint64_t>(a) * n + b;
+}
+
+inline std::vector<Edge> configuration_model(Random &random,
+                                             const std::vector<int> &degrees,
+                                             const int max_attempts) {
+    const int n = static_cast<int>(degrees.size());
+    const uint64_t m = num_edges_from_degrees(degrees);
+    std::vector<int> stubs;
+    stubs.reserve(2u * m);
+    for (int v = 0; v < n; ++v) {
+        stubs.insert(stubs.end(), degrees[v], v);
+    }
+    std::vector<Edge> edges;
+    edges.reserve(m);
+    HashSet64 present(m);
+    for (int attempt = 0; attempt < max_attempts; ++attempt) {
+        // Clear in time proportional to the failed attempt.
+        for (const Edge &edge : edges) {
+            present.erase(edge_key(n, edge.u, edge.v));
+        }
+        edges.clear();
+        // Pair the last unpaired stub with a random other unpaired stub,
+        // as in Fisher-Yates.
+        for (uint64_t remaining = 2u * m; remaining != 0u; remaining -= 2u) {
+            const int u = stubs[remaining - 1u];
+            const uint64_t j = random.uniform_uint64(0, remaining - 2u);
+            const int v = stubs[j];
+            std::swap(stubs[j], stubs[remaining - 2u]);
+            if (u == v || !present.insert(edge_key(n, u, v))) {
+                break;
+            }
+            edges.push_back({u, v});
+        }
+        if (edges.size() == m) {
+            return edges;
+        }
+    }
+    throw std::runtime_error("configuration_model: too many attempts");
+}
+
+inline std::vector<Edge> degree_sequence_graph(Random &random,
+                                               const std::vector<int> &degrees,
+                                               const uint64_t num_switches) {
+    const int n = static_cast<int>(degrees.size());
+    const uint64_t m = num_edges_from_degrees(degrees);
+    std::vector<Edge> edges;
+    edges.reserve(m);
+
+    // Havel-Hakimi: connect the vertex with the smallest residual degree d
+    // to d vertices with the largest residual degrees. order is kept
+    // sorted by decreasing residual degree: among the vertices tied with
+    // the d-th largest, the last ones are decremented.
+    std::vector<int> residual = degrees;
+    std::vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(),
+              [&](const int a, const int b) { return residual[a] > residual[b]; });
+    while (!order.empty()) {
+        const int v = order.back();
+        order.pop_back();
+        const int d = residual[v];
+        if (d == 0) {
+            continue;
+        }
+        if (static_cast<size_t>(d) > order.size() || residual[order[d - 1]] == 0) {
+            throw std::invalid_argument("degrees not graphical");
+        }
+        const int tied = residual[order[d - 1]];
+        const int tied_begin = static_cast<int>(
+            std::partition_point(order.begin(), order.begin() + d,
+                                 [&](const int w) { return residual[w] > tied; }) -
+            order.begin());
+        const int tied_end = static_cast<int>(
+            std::partition_point(order.begin() + d, order.end(),
+                                 [&](const int w) { return residual[w] == tied; }) -
+            order.begin());
+        for (int i = 0; i < tied_begin; ++i) {
+            edges.push_back({v, order[i]});
+            --residual[order[i]];
+        }
+        for (int i = tied_end - (d - tied_begin); i < tied_end; ++i) {
+            edges.push_back({v, order[i]});
+            --residual[order[i]];
+        }
+    }
+
+    if (m >= 2u) {
+        HashSet64 present(m);
+        for (const Edge &edge : edges) {
+            present.insert(edge_key(n, edge.u, edge.v));
+        }
+        // The edges for the next switch are chosen one step ahead and
+        // prefetched, to overlap cache misses.
+        uint64_t next1 = random.uniform_uint64(0, m - 1u);
+        uint64_t next2 = random.uniform_uint64(0, m - 1u);
+        for (uint64_t i = 0; i < num_switches; ++i) {
+            Edge &e1 = edges[next1];
+            Edge &e2 = edges[next2];
+            next1 = random.uniform_uint64(0, m - 1u);
+            next2 = random.uniform_uint64(0, m - 1u);
+            __builtin_prefetch(&edges[next1]);
+            __builtin_prefetch(&edges[next2]);
+            if (random.bits(1)) {
+                std::swap(e2.u, e2.v);
+            }
+            const int a = e1.u;
+            const int b = e1.v;
+            const int c = e2.u;
+            const int d = e2.v;
+            if (a == d || c == b || present.contains(edge_key(n, a, d)) ||
+                present.contains(edge_key(n, c, b))) {
+                continue;
+            }
+            present.erase(edge_key(n, a, b));
+            present.erase(edge_key(n, c, d));
+            present.insert(edge_key(n, a, d));
+            present.insert(edge_key(n, c, b));
+            e1.v = d;
+            e2.v = b;
+        }
+    }
+    random.shuffle(edges.begin(), edges.end());
+    return edges;
+}
+
+} // namespace random_private
+
+using random_private::AdjacencyGraph;
+using random_private::adjacency_graph;
+using random_private::bipartite_graph;
+using random_private::configuration_model;
+using random_private::connected_graph;
+using random_private::dag;
+using random_private::degree_sequence_graph;
+using random_private::edge_from_index;
+using random_private::gnm_graph;
+using random_private::gnp_graph;
+using random_private::grid_graph;
+using random_private::num_possible_edges;
+using random_private::uniform_spanning_tree;
+
+#endif
@@ -0,0 +1,256 @@
+// Random matrices over the integers mod a prime p < 2^31.
+//
+// Matrices are stored contiguously in row-major order.
+
+#ifndef RANDOM_MATRIX_H
+#define RANDOM_MATRIX_H
+
+#include "random.h"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace random_private {
+
+struct Matrix {
+    size_t rows = 0;
+    size_t cols = 0;
+    std::vector<uint32_t> entries;
+
+    Matrix() = default;
+    Matrix(const size_t rows, const size_t cols) : rows(rows), cols(cols), entries(rows * cols) {}
+
+    uint32_t *operator[](const size_t i) { return entries.data() + i * cols; }
+    const uint32_t *operator[](const size_t i) const { return entries.data() + i * cols; }
+};
+
+// a * b mod p.
+//
+// Products are accumulated in 64 bits and reduced lazily, in tiles of b
+// that fit in cache. Zero entries of a and the leading zeros of each row of
+// b are skipped, so triangular factors cost less. Blocks of rows are
+// computed on num_threads threads; 0 means hardware concurrency.
+Matrix multiply(const Matrix &a, const Matrix &b, uint32_t p, unsigned num_threads = 0);
+
+// Independent uniform entries.
+Matrix random_matrix(Random &random, size_t rows, size_t cols, uint32_t p);
+
+// Uniformly random invertible n x n matrix.
+//
+// Bruhat decomposition: every invertible matrix is uniquely L w U for a
+// permutation matrix w, upper triangular U and lower unitriangular L whose
+// nonzero entries below the diagonal stay below it in w^-1 L w. w is drawn
+// with probability proportional to p^-inv(w), the number of such L. w is
+// almost always close to the identity, so the product costs about n^3/3
+// multiply-adds.
+Matrix invertible_matrix(Random &random, size_t n, uint32_t p);
+
+// Uniformly random rows x cols matrix of the given rank.
+//
+// X Y for uniformly random X (rows x rank) and Y (rank x cols) of full
+// rank: every matrix of rank r has the same number of such
+// factorizations. O(rows cols rank).
+Matrix matrix_of_rank(Random &random, size_t rows, size_t cols, size_t rank, uint32_t p);
+
+inline void check_modulus(const uint32_t p) {
+    if (p >= uint32_t{1} << 31 || !is_prime(p)) {
+        throw std::invalid_argument("p must be a prime < 2^31");
+    }
+}
+
+// x mod p for p < 2^31. Barrett reduction: m = floor(2^64 / p) makes the
+// quotient estimate off by at most 1.
+class BarrettReducer {
+public:
+    explicit BarrettReducer(const uint32_t p) : m_p(p), m_inverse(~uint64_t{0} / p) {}
+
+    uint32_t reduce(const uint64_t x) const {
+        const uint64_t q =
+            static_cast<uint64_t>(static_cast<unsigned __int128>(x) * m_inverse >> 64);
+        uint64_t r = x - q * m_p;
+        if (r >= m_p) {
+            r -= m_p;
+        }
+        return static_cast<uint32_t>(r);
+    }
+
+private:
+    uint64_t m_p;
+    uint64_t m_inverse;
+};
+
+inline Matrix multiply(const Matrix &a, const Matrix &b, const uint32_t p, unsigned num_threads) {
+    if (a.cols != b.rows) {
+        throw std::invalid_argument("dimension mismatch");
+    }
+    if (p < 2u || p >= uint32_t{1} << 31) {
+        throw std::invalid_argument("p must be in [2, 2^31)");
+    }
+    if (num_threads == 0u) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    Matrix c(a.rows, b.cols);
+    std::vector<size_t> first_nonzero(b.rows);
+    for (size_t k = 0; k < b.rows; ++k) {
+        const uint32_t *const row = b[k];
+        first_nonzero[k] =
+            std::find_if(row, row + b.cols, [](const uint32_t x) { return x != 0u; }) - row;
+    }
+
+    // Sums stay below 2^63 + p after subtracting modulus_multiple, which
+    // leaves room for max_terms more products.
+    const uint64_t half = uint64_t{1} << 63;
+    const uint64_t modulus_multiple = half / p * p;
+    const uint64_t max_product = uint64_t{p - 1u} * (p - 1u);
+    const uint64_t max_terms =
+        max_product == 0u ? ~uint64_t{0} : (~uint64_t{0} - half - p) / max_product;
+    const BarrettReducer reducer(p);
+
+    constexpr size_t block_rows = 64;
+    constexpr size_t block_k = 256;
+    constexpr size_t block_cols = 512;
+    const size_t num_row_blocks = (a.rows + block_rows - 1u) / block_rows;
+    run_parallel(num_row_blocks, num_threads, [&](const size_t block) {
+        const size_t i0 = block * block_rows;
+        const size_t i1 = std::min(i0 + block_rows, a.rows);
+        std::vector<uint64_t> sums(block_cols);
+        for (size_t j0 = 0; j0 < b.cols; j0 += block_cols) {
+            const size_t j1 = std::min(j0 + block_cols, b.cols);
+            for (size_t k0 = 0; k0 < a.cols; k0 += block_k) {
+                const size_t k1 = std::min(k0 + block_k, a.cols);
+                for (size_t i = i0; i < i1; ++i) {
+                    const uint32_t *const a_row = a[i];
+                    uint32_t *const c_row = c[i];
+                    std::copy(c_row + j0, c_row + j1, sums.begin());
+                    uint64_t num_terms = 0;
+                    bool changed = false;
+                    for (size_t k = k0; k < k1; ++k) {
+                        const uint64_t x = a_row[k];
+                        const size_t start = std::max(j0, first_nonzero[k]);
+                        if (x == 0u || start >= j1) {
+                            continue;
+                        }
+                        if (num_terms == max_terms) {
+                            for (size_t j = 0; j < j1 - j0; ++j) {
+                                sums[j] -= sums[j] >= modulus_multiple ? modulus_multiple : 0u;
+                            }
+                            num_terms = 0;
+                        }
+                        const uint32_t *const b_row = b[k];
+                        uint64_t *const s = sums.data();
+                        for (size_t j = start; j < j1; ++j) {
+                            s[j - j0] += x * b_row[j];
+                        }
+                        ++num_terms;
+                        changed = true;
+                    }
+                    if (changed) {
+                        for (size_t j = j0; j < j1; ++j) {
+                            c_row[j] = reducer.reduce(sums[j - j0]);
+                        }
+                    }
+                }
+            }
+        }
+    });
+    return c;
+}
+
+inline Matrix random_matrix(Random &random, const size_t rows, const size_t cols, const uint32_t p) {
+    check_modulus(p);
+    Matrix m(rows, cols);
+    random.uniform_ints(m.entries.begin(), m.entries.end(), uint32_t{0}, p - 1u);
+    return m;
+}
+
+// Uniformly random rows x cols matrix with independent columns: the first
+// cols columns of a uniformly random invertible matrix, L w U restricted to
+// the first cols columns of w and U.
+inline Matrix independent_columns(Random &random, const size_t rows, const size_t cols,
+                                  const uint32_t p) {
+    if (cols > rows) {
+        throw std::invalid_argument("cols > rows");
+    }
+    // w from its Lehmer code: code[i] = #{j > i : w[j] < w[i]}, each
+    // independently truncated geometric with ratio 1/p.
+    std::vector<size_t> w(rows);
+    std::vector<size_t> unused(rows);
+    for (size_t i = 0; i < rows; ++i) {
+        unused[i] = i;
+    }
+    for (size_t i = 0; i < rows; ++i) {
+        const size_t max_code = rows - 1u - i;
+        size_t code;
+        do {
+            code = 0;
+            while (random.uniform_uint(0, p - 1u) == 0u) {
+                ++code;
+            }
+        } while (code > max_code);
+        w[i] = unused[code];
+        unused.erase(unused.begin() + code);
+    }
+    std::vector<size_t> w_inverse(rows);
+    for (size_t i = 0; i < rows; ++i) {
+        w_inverse[w[i]] = i;
+    }
+
+    // (L w)[i][k] = L[i][w[k]]: 1 at i = w[k], free when i > w[k] and
+    // w_inverse[i] > k, 0 otherwise.
+    Matrix lw(rows, cols);
+    for (size_t i = 0; i < rows; ++i) {
+        uint32_t *const row = lw[i];
+        const size_t end = std::min(w_inverse[i], cols);
+        random.uniform_ints(row, row + end, uint32_t{0}, p - 1u);
+        for (size_t k = 0; k < end; ++k) {
+            if (w[k] > i) {
+                row[k] = 0;
+            }
+        }
+        if (w_inverse[i] < cols) {
+            row[w_inverse[i]] = 1;
+        }
+    }
+
+    Matrix u(cols, cols);
+    for (size_t k = 0; k < cols; ++k) {
+        uint32_t *const row = u[k];
+        row[k] = random.uniform_uint(1, p - 1u);
+        random.uniform_ints(row + k + 1, row + cols, uint32_t{0}, p - 1u);
+    }
+    return multiply(lw, u, p);
+}
+
+inline Matrix invertible_matrix(Random &random, const size_t n, const uint32_t p) {
+    check_modulus(p);
+    return independent_columns(random, n, n, p);
+}
+
+inline Matrix matrix_of_rank(Random &random, const size_t rows, const size_t cols,
+                             const size_t rank, const uint32_t p) {
+    check_modulus(p);
+    if (rank > rows || rank > cols) {
+        throw std::invalid_argument("rank too large");
+    }
+    const Matrix x = independent_columns(random, rows, rank, p);
+    const Matrix y_transposed = independent_columns(random, cols, rank, p);
+    Matrix y(rank, cols);
+    for (size_t i = 0; i < cols; ++i) {
+        for (size_t k = 0; k < rank; ++k) {
+            y[k][i] = y_transposed[i][k];
+        }
+    }
+    return multiply(x, y, p);
+}
+
+} // namespace random_private
+
+using random_private::Matrix;
+using random_private::invertible_matrix;
+using random_private::matrix_of_rank;
+using random_private::multiply;
+using random_private::random_matrix;
+
+#endif
@@ -0,0 +1,175 @@
+// Random trees.
+//
+// Vertices are 0, ..., n-1. Trees are returned as lists of n-1 edges.
+
+#ifndef RANDOM_TREE_H
+#define RANDOM_TREE_H
+
+#include "random.h"
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace random_private {
+
+struct Edge {
+    int u;
+    int v;
+};
+
+// Tree with Prufer sequence code on code.size() + 2 vertices. O(n).
+std::vector<Edge> prufer_decode(const std::vector<int> &code);
+
+// Uniformly random labeled tree. O(n).
+std::vector<Edge> random_tree(Random &random, int n);
+
+// Random recursive tree: each vertex v > 0 is attached to a uniformly
+// random earlier vertex, among those with fewer than max_degree neighbors
+// and depth less than max_depth. Vertex 0 is the root, at depth 0.
+//
+// Not uniform among all trees with these bounds. Labels reveal the
+// structure: use relabel. O(n).
+std::vector<Edge> bounded_tree(Random &random, int n,
+                               int max_degree = std::numeric_limits<int>::max(),
+                               int max_depth = std::numeric_limits<int>::max());
+
+// Path 0, ..., spine_length-1, with each other vertex attached to a
+// uniformly random vertex of the path. 1 <= spine_length <= n.
+//
+// Labels reveal the structure: use relabel. O(n).
+std::vector<Edge> caterpillar(Random &random, int n, int spine_length);
+
+// Applies a uniformly random permutation to the n vertex labels, shuffles
+// the edges and orients each edge randomly.
+void relabel(Random &random, int n, std::vector<Edge> &edges);
+
+inline std::vector<Edge> prufer_decode(const std::vector<int> &code) {
+    const int n = static_cast<int>(code.size()) + 2;
+    std::vector<int> degree(n, 1);
+    for (const int v : code) {
+        if (v < 0 || v >= n) {
+            throw std::invalid_argument("invalid Prufer code");
+        }
+        ++degree[v];
+    }
+    std::vector<Edge> edges;
+    edges.reserve(n - 1);
+    // ptr scans for leaves in increasing order.
+    int ptr = 0;
+    while (degree[ptr] != 1) {
+        ++ptr;
+    }
+    int leaf = ptr;
+    for (const int v : code) {
+        edges.push_back({leaf, v});
+        if (--degree[v] == 1 && v < ptr) {
+            leaf = v;
+        } else {
+            do {
+                ++ptr;
+            } while (degree[ptr] != 1);
+            leaf = ptr;
+        }
+    }
+    edges.push_back({leaf, n - 1});
+    return edges;
+}
+
+inline std::vector<Edge> random_tree(Random &random, const int n) {
+    if (n < 0) {
+        throw std::invalid_argument("n < 0");
+    }
+    if (n <= 1) {
+        return {};
+    }
+    std::vector<int> code(n - 2);
+    random.uniform_ints(code.begin(), code.end(), 0, n - 1);
+    return prufer_decode(code);
+}
+
+inline std::vector<Edge> bounded_tree(Random &random, const int n,
+                                      const int max_degree, const int max_depth) {
+    if (n < 0 || max_degree < 0 || max_depth < 0) {
+        throw std::invalid_argument("negative argument");
+    }
+    std::vector<Edge> edges;
+    if (n == 0) {
+        return edges;
+    }
+    edges.reserve(n - 1);
+    if (max_degree >= n && max_depth >= n) {
+        // No constraints.
+        for (int v = 1; v < n; ++v) {
+            edges.push_back({random.uniform_int(0, v - 1), v});
+        }
+        return edges;
+    }
+    // Vertices that can get another child. Kept together for locality.
+    struct Open {
+        int vertex;
+        int depth;
+        int free_degree;
+    };
+    std::vector<Open> open;
+    if (max_degree > 0 && max_depth > 0) {
+        open.push_back({0, 0, max_degree});
+    }
+    for (int v = 1; v < n; ++v) {
+        if (open.empty()) {
+            throw std::invalid_argument("n too large for max_degree and max_depth");
+        }
+        const int i = random.uniform_int(0, static_cast<int>(open.size()) - 1);
+        Open &parent = open[i];
+        edges.push_back({parent.vertex, v});
+        const int depth = parent.depth + 1;
+        if (--parent.free_degree == 0) {
+            parent = open.back();
+            open.pop_back();
+        }
+        if (max_degree > 1 && depth < max_depth) {
+            open.push_back({v, depth, max_degree - 1});
+        }
+    }
+    return edges;
+}
+
+inline std::vector<Edge> caterpillar(Random &random, const int n, const int spine_length) {
+    if (spine_length < 1 || spine_length > n) {
+        throw std::invalid_argument("invalid spine_length");
+    }
+    std::vector<Edge> edges;
+    edges.reserve(n - 1);
+    for (int v = 1; v < spine_length; ++v) {
+        edges.push_back({v - 1, v});
+    }
+    for (int v = spine_length; v < n; ++v) {
+        edges.push_back({random.uniform_int(0, spine_length - 1), v});
+    }
+    return edges;
+}
+
+inline void relabel(Random &random, const int n, std::vector<Edge> &edges) {
+    std::vector<int> label(n);
+    std::iota(label.begin(), label.end(), 0);
+    random.parallel_shuffle(label.begin(), label.end());
+    random.parallel_shuffle(edges.begin(), edges.end());
+    for (Edge &edge : edges) {
+        if (random.bits(1)) {
+            std::swap(edge.u, edge.v);
+        }
+        edge.u = label[edge.u];
+        edge.v = label[edge.v];
+    }
+}
+
+} // namespace random_private
+
+using random_private::Edge;
+using random_private::bounded_tree;
+using random_private::caterpillar;
+using random_private::prufer_decode;
+using random_private::random_tree;
+using random_private::relabel;
+
+#endif
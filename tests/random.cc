@@ -1,8 +1,12 @@
 #include "random.h"
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <iostream>
+#include <map>
+#include <numeric>
+#include <vector>
 
 void test_chacha() {
   // https://datatracker.ietf.org/doc/html/draft-strombergson-chacha-test-vectors-00
@@ -24,8 +28,52 @@ void test_chacha() {
   assert(output == expected_output);
 }
 
-void test_uniform_int() {
+void test_chacha_blocks() {
+  const std::uint64_t nonce = 0x218268cfd531da1a;
+  const std::uint64_t counter = 0xfffffffe;
+  const auto output = random_private::chacha_blocks<20>(random_private::key, nonce, counter);
+  for (int i = 0; i < random_private::num_parallel_blocks; ++i) {
+    const auto block = random_private::chacha<20>(random_private::key, nonce, counter + i);
+    assert(std::equal(block.begin(), block.end(), output.begin() + 16 * i));
+  }
+}
+
+void test_bits_v1() {
+  // Values generated before Version was introduced.
+  Random random("foo", 123, Random::Version::v1);
+  std::uint64_t hash = 0;
+  for (int i = 0; i < 1000; ++i) {
+    hash = hash * 1000003 + random.bits(i % 65);
+    hash = hash * 1000003 + random.uniform_uint64(0, i * 7919 + 1);
+    hash = hash * 1000003 + random.uniform_uint64(0, ~std::uint64_t{0});
+  }
+  assert(hash == 0x86AF871A89F1B11C);
+
+  // Ranges wider than 2^63 that the number buffer can hold.
+  hash = 0;
+  for (int i = 0; i < 1000; ++i) {
+    hash = hash * 1000003 + random.uniform_uint64(0, i * 7919 + 1);
+    hash = hash * 1000003 +
+           random.uniform_int64(-(std::int64_t{1} << 62), std::int64_t{1} << 62);
+  }
+  assert(hash == 0x1A42DE8A993AEA13);
+}
+
+void test_bits_v2() {
+  Random random("foo", 123);
+  Random random2("foo", 123);
+  for (int n = 0; n <= 64; ++n) {
+    const std::uint64_t a = random.bits(n);
+    const std::uint64_t b = random.bits(64 - n);
+    assert(n == 64 || a >> n == 0);
+    const std::uint64_t combined = n == 64 ? a : a | b << n;
+    assert(random2.bits(64) == combined);
+  }
+}
+
+void test_uniform_int(const Random::UniformMethod method) {
   Random random("foo", 123);
+  random.set_uniform_method(method);
 
   for (const int n : {17, 1900000000}) {
     const double n_d = n;
@@ -41,6 +89,326 @@ void test_uniform_int() {
 
     assert(std::fabs(total - num_iters * mean) < 4.0 * std::sqrt(num_iters * variance));
   }
+
+  const std::uint64_t large_n = 15000000000000000000u;
+  bool found_large = false;
+  for (int i = 0; i < 100; ++i) {
+    const std::uint64_t a = random.uniform_uint64(10, large_n + 9);
+    assert(a >= 10 && a < large_n + 10);
+    found_large = found_large || a > large_n / 2;
+  }
+  assert(found_large);
+}
+
+void test_uniform_ints() {
+  Random random("foo", 123);
+
+  std::vector<int> small(110000);
+  random.uniform_ints(small.begin(), small.end(), -5, 5);
+  std::array<int, 11> counts = {};
+  for (const int x : small) {
+    assert(x >= -5 && x <= 5);
+    ++counts[x + 5];
+  }
+  for (const int count : counts) {
+    assert(std::abs(count - 10000) < 500);
+  }
+
+  std::vector<std::int64_t> large(1000);
+  const std::int64_t min = -3000000000000000000;
+  const std::int64_t max = 4000000000000000000;
+  random.uniform_ints(large.begin(), large.end(), min, max);
+  for (const std::int64_t x : large) {
+    assert(x >= min && x <= max);
+  }
+  assert(*std::min_element(large.begin(), large.end()) < min / 2);
+  assert(*std::max_element(large.begin(), large.end()) > max / 2);
+
+  std::vector<std::uint64_t> full(1000);
+  random.uniform_ints(full.begin(), full.end(), std::uint64_t{0}, ~std::uint64_t{0});
+  assert(*std::max_element(full.begin(), full.end()) > ~std::uint64_t{0} / 2);
+}
+
+void test_uniform_int_distribution() {
+  Random random("foo", 123);
+
+  const UniformIntDistribution<int> small(-5, 5);
+  assert(small.min() == -5 && small.max() == 5);
+  std::array<int, 11> counts = {};
+  for (int i = 0; i < 110000; ++i) {
+    const int x = random.sample(small);
+    assert(x >= -5 && x <= 5);
+    ++counts[x + 5];
+  }
+  for (const int count : counts) {
+    assert(std::abs(count - 10000) < 500);
+  }
+
+  const UniformIntDistribution<std::uint64_t> large(1, 12000000000000000000u);
+  const UniformIntDistribution<std::uint64_t> full(0, ~std::uint64_t{0});
+  bool found_large = false;
+  bool found_full = false;
+  for (int i = 0; i < 100; ++i) {
+    const std::uint64_t a = random.sample(large);
+    assert(a >= 1 && a <= 12000000000000000000u);
+    found_large = found_large || a > 6000000000000000000u;
+    found_full = found_full || random.sample(full) > 12000000000000000000u;
+  }
+  assert(found_large && found_full);
+}
+
+template <typename T>
+void test_uniform_real_type() {
+  Random random("foo", 123);
+
+  const int num_iters = 100000;
+  T total = 0;
+  for (int i = 0; i < num_iters; ++i) {
+    const T x = random.uniform_real<T>(-1, 3);
+    assert(x >= -1 && x < 3);
+    total += x;
+  }
+  // mean 1, variance 4/3
+  assert(std::fabs(total / num_iters - 1) < 4 * std::sqrt(4.0 / 3.0 / num_iters));
+
+  std::vector<T> values(1000);
+  random.uniform_reals(values.begin(), values.end(), T(2), T(5), Random::Interval::open);
+  for (const T x : values) {
+    assert(x > 2 && x < 5);
+  }
+}
+
+void test_uniform_real() {
+  test_uniform_real_type<float>();
+  test_uniform_real_type<double>();
+  test_uniform_real_type<long double>();
+
+  // Only min and max in the interval.
+  Random random("foo", 123);
+  const double min = 1.0;
+  const double max = std::nextafter(min, 2.0);
+  bool found_min = false;
+  bool found_max = false;
+  for (int i = 0; i < 100; ++i) {
+    const double x = random.uniform_real(min, max, Random::Interval::closed);
+    assert(x == min || x == max);
+    found_min = found_min || x == min;
+    found_max = found_max || x == max;
+    assert(random.uniform_real(min, max, Random::Interval::closed_open) == min);
+    assert(random.uniform_real(min, max, Random::Interval::open_closed) == max);
+  }
+  assert(found_min && found_max);
+}
+
+void test_fill_string() {
+  Random random("foo", 123);
+  for (const std::string_view alphabet : {"acgt", "abc", "01", "abcdefghijklmnopqrstuvwxyz"}) {
+    std::string s(26000 * alphabet.size(), ' ');
+    random.fill_string(s.begin(), s.end(), alphabet);
+    for (const char c : alphabet) {
+      const long count = std::count(s.begin(), s.end(), c);
+      assert(std::abs(count - 26000) < 700);
+    }
+    assert(std::count(s.begin(), s.end(), ' ') == 0);
+  }
+  std::string s(5, ' ');
+  random.fill_string(s.begin(), s.end(), "x");
+  assert(s == "xxxxx");
+}
+
+void test_balanced_brackets() {
+  Random random("foo", 123);
+  std::string s(100000, ' ');
+  random.balanced_brackets(s.begin(), s.end());
+  int depth = 0;
+  for (const char c : s) {
+    assert(c == '(' || c == ')');
+    depth += c == '(' ? 1 : -1;
+    assert(depth >= 0);
+  }
+  assert(depth == 0);
+
+  // All 5 Dyck words of length 6 equally likely.
+  std::map<std::string, int> counts;
+  for (int trial = 0; trial < 5000; ++trial) {
+    std::string t(6, ' ');
+    random.balanced_brackets(t.begin(), t.end(), 'a', 'b');
+    ++counts[t];
+  }
+  assert(counts.size() == 5);
+  for (const auto &[t, count] : counts) {
+    assert(count > 850 && count < 1150);
+  }
+}
+
+void test_distinct_strings() {
+  Random random("foo", 123);
+  std::vector<size_t> lengths;
+  for (int i = 0; i < 100000; ++i) lengths.push_back(random.uniform_int(8, 10));
+  // All 4^2 strings of length 2 and the empty string.
+  lengths.insert(lengths.end(), 16, 2);
+  lengths.push_back(0);
+  const StringTable table = random.distinct_strings(lengths, "acgt");
+  assert(table.size() == lengths.size());
+  std::vector<std::string_view> strings;
+  for (size_t i = 0; i < table.size(); ++i) {
+    assert(table[i].size() == lengths[i]);
+    assert(table[i].find_first_not_of("acgt") == std::string_view::npos);
+    strings.push_back(table[i]);
+  }
+  std::sort(strings.begin(), strings.end());
+  assert(std::adjacent_find(strings.begin(), strings.end()) == strings.end());
+
+  bool thrown = false;
+  try {
+    random.distinct_strings({1, 1, 1}, "ab");
+  } catch (const std::invalid_argument &) {
+    thrown = true;
+  }
+  assert(thrown);
+}
+
+void test_portable_math() {
+  for (double x = -700.0; x < 700.0; x += 0.37) {
+    assert(std::fabs(random_private::portable_exp(x) / std::exp(x) - 1.0) < 1e-15);
+  }
+  for (double x = 1e-300; x < 1e300; x *= 1.7) {
+    const double expected = std::log(x);
+    assert(std::fabs(random_private::portable_log(x) - expected) <= 1e-15 * std::fabs(expected));
+  }
+  assert(random_private::portable_log1p(1e-18) == 1e-18);
+  static_assert(random_private::normal_ziggurat.x[256] == 0.0);
+}
+
+void test_normal() {
+  Random random("foo", 123);
+  const int num_iters = 100000;
+  double total = 0.0;
+  double total_squares = 0.0;
+  for (int i = 0; i < num_iters; ++i) {
+    const double x = random.normal(10.0, 2.0);
+    total += x;
+    total_squares += (x - 10.0) * (x - 10.0);
+  }
+  assert(std::fabs(total / num_iters - 10.0) < 4.0 * 2.0 / std::sqrt(num_iters));
+  assert(std::fabs(total_squares / num_iters - 4.0) < 4.0 * 4.0 * std::sqrt(2.0 / num_iters));
+}
+
+void test_exponential() {
+  Random random("foo", 123);
+  const int num_iters = 100000;
+  double total = 0.0;
+  int num_large = 0;
+  for (int i = 0; i < num_iters; ++i) {
+    const double x = random.exponential(0.5);
+    assert(x >= 0.0);
+    total += x;
+    num_large += x > 10.0;
+  }
+  assert(std::fabs(total / num_iters - 2.0) < 4.0 * 2.0 / std::sqrt(num_iters));
+  // P(x > 10) = e^-5
+  const double expected_large = num_iters * std::exp(-5.0);
+  assert(std::fabs(num_large - expected_large) < 4.0 * std::sqrt(expected_large));
+}
+
+// Exact values, the same on every platform and with any compiler flags.
+void test_real_golden_values() {
+  Random random("foo", 123);
+  assert(random.normal(0.3, 1.7) == -0x1.b53ad899a3441p+0);
+  assert(random.normal(0.3, 1.7) == 0x1.179c978194761p+1);
+  assert(random.normal(0.3, 1.7) == 0x1.1f3bd8e10accfp+0);
+  assert(random.exponential(2.5) == 0x1.89cb0060607a6p-4);
+  assert(random.exponential(2.5) == 0x1.ea14d5c431f7dp-5);
+  assert(random.exponential(2.5) == 0x1.9e2ef59ebd1bap-3);
+  // Also covers the tails and wedges of the ziggurats.
+  double total_normal = 0.0;
+  double total_exponential = 0.0;
+  for (int i = 0; i < 100000; ++i) {
+    total_normal += random.normal(0.3, 1.7);
+    total_exponential += random.exponential(2.5);
+  }
+  assert(total_normal == 0x1.da6703b4cb25p+14);
+  assert(total_exponential == 0x1.382625c623d45p+15);
+}
+
+void test_discrete_distribution() {
+  Random random("foo", 123);
+
+  const std::vector<int> weights = {3, 0, 1, 6};
+  const DiscreteDistribution distribution(weights.begin(), weights.end());
+  assert(distribution.size() == 4);
+  const int num_iters = 100000;
+  std::array<int, 4> counts = {};
+  for (int i = 0; i < num_iters; ++i) {
+    ++counts[random.sample(distribution)];
+  }
+  assert(counts[1] == 0);
+  for (int i = 0; i < 4; ++i) {
+    const double p = weights[i] / 10.0;
+    const double expected = num_iters * p;
+    assert(std::fabs(counts[i] - expected) <= 4.0 * std::sqrt(num_iters * p * (1.0 - p)));
+  }
+
+  const std::vector<double> real_weights = {0.25, 0.75};
+  const DiscreteDistribution real_distribution(real_weights.begin(), real_weights.end());
+  int num_ones = 0;
+  for (int i = 0; i < num_iters; ++i) {
+    num_ones += random.sample(real_distribution);
+  }
+  assert(std::fabs(num_ones - 0.75 * num_iters) <= 4.0 * std::sqrt(num_iters * 0.75 * 0.25));
+
+  const std::vector<std::uint64_t> huge_weights = {~std::uint64_t{0} - 1, 1};
+  const DiscreteDistribution huge_distribution(huge_weights.begin(), huge_weights.end());
+  for (int i = 0; i < 100; ++i) {
+    assert(random.sample(huge_distribution) == 0);
+  }
+
+  // The total of these overflows double unless they are scaled first.
+  const std::vector<double> huge_real_weights = {1e308, 1e308, 1e308, 0.0};
+  const DiscreteDistribution huge_real_distribution(huge_real_weights.begin(),
+                                                    huge_real_weights.end());
+  for (int i = 0; i < 100; ++i) {
+    assert(random.sample(huge_real_distribution) != 3u);
+  }
+}
+
+template <typename F>
+void check_mean_variance(F sample, const double mean, const double variance) {
+  const int num_iters = 100000;
+  double total = 0.0;
+  double total_squares = 0.0;
+  for (int i = 0; i < num_iters; ++i) {
+    const double x = sample() - mean;
+    total += x;
+    total_squares += x * x;
+  }
+  assert(std::fabs(total / num_iters) < 4.0 * std::sqrt(variance / num_iters));
+  assert(std::fabs(total_squares / num_iters - variance) < 0.05 * variance);
+}
+
+void test_binomial() {
+  Random random("foo", 123);
+  check_mean_variance([&] { return random.binomial(20, 0.3); }, 6.0, 4.2);
+  check_mean_variance([&] { return random.binomial(1000, 0.9); }, 900.0, 90.0);
+  check_mean_variance([&] {
+    return static_cast<double>(static_cast<std::int64_t>(
+        random.binomial(1000000000000000000, 0.5) - 500000000000000000));
+  }, 0.0, 2.5e17);
+  assert(random.binomial(10, 0.0) == 0);
+  assert(random.binomial(10, 1.0) == 10);
+}
+
+void test_poisson() {
+  Random random("foo", 123);
+  check_mean_variance([&] { return random.poisson(3.0); }, 3.0, 3.0);
+  check_mean_variance([&] { return random.poisson(1000.0); }, 1000.0, 1000.0);
+  assert(random.poisson(0.0) == 0);
+}
+
+void test_geometric() {
+  Random random("foo", 123);
+  check_mean_variance([&] { return random.geometric(0.2); }, 4.0, 20.0);
+  assert(random.geometric(1.0) == 0);
 }
 
 void test_shuffle() {
@@ -52,9 +420,428 @@ void test_shuffle() {
   assert(w == v);
 }
 
+void test_parallel_shuffle() {
+  // Large enough for several blocks.
+  std::vector<int> v(300000);
+  for (size_t i = 0; i < v.size(); ++i) v[i] = i;
+  std::vector<int> w1 = v;
+  std::vector<int> w4 = v;
+  Random random1("foo", 123);
+  random1.parallel_shuffle(w1.begin(), w1.end(), 1);
+  Random random4("foo", 123);
+  random4.parallel_shuffle(w4.begin(), w4.end(), 4);
+  assert(w1 == w4);
+  assert(w1 != v);
+  std::sort(w1.begin(), w1.end());
+  assert(w1 == v);
+
+  // Merging shuffled halves gives all permutations equally often.
+  Random random("foo", 123);
+  std::vector<int> counts(6);
+  const int num_trials = 60000;
+  for (int trial = 0; trial < num_trials; ++trial) {
+    std::array<int, 3> a = {0, 1, 2};
+    if (random.bits(1)) std::swap(a[1], a[2]);
+    random_private::merge_shuffled(random, a.begin(), a.begin() + 1, a.end());
+    ++counts[a[0] * 2 + (a[1] > a[2])];
+  }
+  for (const int count : counts) {
+    assert(std::abs(count - num_trials / 6) < 500);
+  }
+}
+
+// Checks that gen() returns valid permutations satisfying property, and that
+// all num_outcomes of them are roughly equally likely.
+template <typename F, typename P>
+void check_permutations(F gen, P property, const int num_outcomes) {
+  std::map<std::vector<int>, int> counts;
+  const int num_trials = 1000 * num_outcomes;
+  for (int trial = 0; trial < num_trials; ++trial) {
+    const std::vector<int> p = gen();
+    std::vector<int> sorted = p;
+    std::sort(sorted.begin(), sorted.end());
+    for (size_t i = 0; i < sorted.size(); ++i) assert(sorted[i] == int(i));
+    assert(property(p));
+    ++counts[p];
+  }
+  assert(int(counts.size()) == num_outcomes);
+  for (const auto &[p, count] : counts) {
+    assert(count > 850 && count < 1150);
+  }
+}
+
+int count_cycles(const std::vector<int> &p) {
+  std::vector<bool> visited(p.size());
+  int num_cycles = 0;
+  for (size_t i = 0; i < p.size(); ++i) {
+    if (visited[i]) continue;
+    ++num_cycles;
+    for (size_t j = i; !visited[j]; j = p[j]) visited[j] = true;
+  }
+  return num_cycles;
+}
+
+void test_constrained_permutations() {
+  Random random("foo", 123);
+  check_permutations(
+    [&] { return random.derangement(5); },
+    [](const std::vector<int> &p) {
+      for (size_t i = 0; i < p.size(); ++i) if (p[i] == int(i)) return false;
+      return true;
+    },
+    44);
+  check_permutations(
+    [&] { return random.cyclic_permutation(5); },
+    [](const std::vector<int> &p) { return count_cycles(p) == 1; },
+    24);
+  check_permutations(
+    [&] { return random.involution(5); },
+    [](const std::vector<int> &p) {
+      for (size_t i = 0; i < p.size(); ++i) if (p[p[i]] != int(i)) return false;
+      return true;
+    },
+    26);
+  check_permutations(
+    [&] { return random.permutation_with_cycles(5, 2); },
+    [](const std::vector<int> &p) { return count_cycles(p) == 2; },
+    50);
+  check_permutations(
+    [&] { return random.permutation_with_cycles(8, 7); },
+    [](const std::vector<int> &p) { return count_cycles(p) == 7; },
+    28);
+
+  const std::vector<int> large = random.permutation_with_cycles(100000, 30);
+  assert(count_cycles(large) == 30);
+  const auto start = std::chrono::steady_clock::now();
+  for (const int k : {100000, 500000, 999000}) {
+    assert(count_cycles(random.permutation_with_cycles(1000000, k)) == k);
+  }
+  assert(std::chrono::steady_clock::now() - start < std::chrono::seconds(10));
+  assert(random.derangement(0).empty());
+}
+
+void test_hash_set() {
+  // Small values collide a lot when reduced to few slots.
+  Random random("foo", 123);
+  random_private::HashSet64 set;
+  std::vector<bool> present(100);
+  size_t size = 0;
+  for (int i = 0; i < 100000; ++i) {
+    const int x = random.uniform_int(0, 99);
+    const std::uint64_t key = x == 99 ? ~std::uint64_t{0} : std::uint64_t(x) << 40;
+    if (random.bits(1)) {
+      assert(set.insert(key) == !present[x]);
+      size += !present[x];
+      present[x] = true;
+    } else {
+      assert(set.erase(key) == present[x]);
+      size -= present[x];
+      present[x] = false;
+    }
+    assert(set.size() == size);
+    assert(set.contains(key) == present[x]);
+  }
+  for (int x = 0; x < 100; ++x) {
+    const std::uint64_t key = x == 99 ? ~std::uint64_t{0} : std::uint64_t(x) << 40;
+    assert(set.contains(key) == present[x]);
+  }
+}
+
+void test_sample_distinct() {
+  Random random("foo", 123);
+
+  // Small range, medium range, huge range.
+  for (const std::int64_t max : {std::int64_t{14}, std::int64_t{200}, std::int64_t{1} << 62}) {
+    for (const bool sorted : {false, true}) {
+      std::vector<std::int64_t> sample = random.sample_distinct<std::int64_t>(10, -5, max, sorted);
+      assert(sample.size() == 10);
+      assert(std::is_sorted(sample.begin(), sample.end()) || !sorted);
+      for (const std::int64_t x : sample) {
+        assert(x >= -5 && x <= max);
+      }
+      std::sort(sample.begin(), sample.end());
+      assert(std::adjacent_find(sample.begin(), sample.end()) == sample.end());
+    }
+  }
+
+  const std::vector<std::uint64_t> full =
+    random.sample_distinct<std::uint64_t>(5, 0, ~std::uint64_t{0});
+  assert(full.size() == 5);
+  const std::vector<std::uint64_t> full_sorted =
+    random.sample_distinct<std::uint64_t>(5, 0, ~std::uint64_t{0}, true);
+  assert(std::is_sorted(full_sorted.begin(), full_sorted.end()));
+  assert(random.sample_distinct(0, 1, 1).empty());
+  assert(random.sample_distinct(1, 7, 7) == std::vector<int>{7});
+
+  // Each element of [0, 10) appears in a 3-subset with probability 3/10.
+  for (const int max : {9, 1000}) {
+    const int num_iters = 10000;
+    int count = 0;
+    bool in_order = true;
+    for (int i = 0; i < num_iters; ++i) {
+      const std::vector<int> sample = random.sample_distinct(3, 0, max);
+      count += std::count(sample.begin(), sample.end(), 0);
+      in_order = in_order && std::is_sorted(sample.begin(), sample.end());
+    }
+    const double p = 3.0 / (max + 1);
+    assert(std::fabs(count - num_iters * p) < 4.0 * std::sqrt(num_iters * p * (1.0 - p)));
+    assert(!in_order);
+  }
+}
+
+void test_sorted_sample() {
+  Random random("foo", 123);
+
+  // Algorithm D, then A; algorithm A throughout.
+  for (const std::uint64_t n : {1000, 40}) {
+    const int num_iters = 10000;
+    const std::uint64_t k = 10;
+    int count = 0;
+    for (int i = 0; i < num_iters; ++i) {
+      SortedSample sample = random.sorted_sample(k, n);
+      std::uint64_t previous = 0;
+      for (std::uint64_t j = 0; j < k; ++j) {
+        assert(sample.remaining() == k - j);
+        const std::uint64_t x = sample.next();
+        assert(x < n && (j == 0 || x > previous));
+        count += x == n / 2;
+        previous = x;
+      }
+      assert(sample.remaining() == 0);
+    }
+    const double p = static_cast<double>(k) / n;
+    assert(std::fabs(count - num_iters * p) < 4.0 * std::sqrt(num_iters * p * (1.0 - p)));
+  }
+
+  SortedSample sample = random.sorted_sample(1000, 1000000000000);
+  double total = 0.0;
+  while (sample.remaining() != 0) {
+    total += sample.next();
+  }
+  assert(std::fabs(total / 1000 / 1e12 - 0.5) < 0.05);
+}
+
+void test_composition() {
+  Random random("foo", 123);
+  const std::vector<std::int64_t> parts = random.composition<std::int64_t>(1000000, 1000, -5);
+  assert(parts.size() == 1000u);
+  assert(std::accumulate(parts.begin(), parts.end(), std::int64_t{0}) == 1000000);
+  assert(*std::min_element(parts.begin(), parts.end()) >= -5);
+  assert(random.composition<int>(7, 7, 1) == std::vector<int>(7, 1));
+
+  // All 6 compositions of 5 into 3 positive parts equally likely.
+  std::map<std::vector<int>, int> counts;
+  for (int trial = 0; trial < 6000; ++trial) {
+    ++counts[random.composition(5, 3)];
+  }
+  assert(counts.size() == 6);
+  for (const auto &[c, count] : counts) {
+    assert(count > 850 && count < 1150);
+  }
+}
+
+void test_integer_partition() {
+  Random random("foo", 123);
+  for (const std::uint64_t n : {1u, 2u, 100u, 1000000u}) {
+    const std::vector<std::uint64_t> parts = random.integer_partition(n);
+    assert(std::accumulate(parts.begin(), parts.end(), std::uint64_t{0}) == n);
+    assert(std::is_sorted(parts.rbegin(), parts.rend()));
+    assert(parts.back() >= 1u);
+  }
+  assert(random.integer_partition(0).empty());
+
+  // All 11 partitions of 6 equally likely.
+  std::map<std::vector<std::uint64_t>, int> counts;
+  for (int trial = 0; trial < 11000; ++trial) {
+    ++counts[random.integer_partition(6)];
+  }
+  assert(counts.size() == 11);
+  for (const auto &[p, count] : counts) {
+    assert(count > 850 && count < 1150);
+  }
+}
+
+void test_is_prime() {
+  // Sieve.
+  const int limit = 100000;
+  std::vector<bool> sieve(limit, true);
+  sieve[0] = sieve[1] = false;
+  for (int i = 2; i * i < limit; ++i) {
+    if (sieve[i]) for (int j = i * i; j < limit; j += i) sieve[j] = false;
+  }
+  std::vector<std::uint64_t> numbers(limit);
+  for (int i = 0; i < limit; ++i) numbers[i] = i;
+  std::vector<bool> batch(limit);
+  is_prime(numbers.begin(), numbers.end(), batch.begin());
+  for (int i = 0; i < limit; ++i) {
+    assert(is_prime(i) == sieve[i]);
+    assert(batch[i] == sieve[i]);
+  }
+
+  // Strong pseudoprimes to several bases, Carmichael numbers, large primes.
+  const std::vector<std::pair<std::uint64_t, bool>> cases = {
+    {3215031751u, false},
+    {3825123056546413051u, false},
+    {561u, false},
+    {2147483647u, true},
+    {1000000007u, true},
+    {4294967291u, true},
+    {18446744073709551557u, true},
+    {18446744073709551615u, false},
+    {(std::uint64_t(1) << 61) - 1u, true},
+    {std::uint64_t(4294967291u) * 4294967279u, false},
+  };
+  for (const auto &[n, expected] : cases) {
+    assert(is_prime(n) == expected);
+  }
+}
+
+void test_prime() {
+  Random random("foo", 123);
+  for (int i = 0; i < 100; ++i) {
+    const std::uint64_t p = random.prime(std::uint64_t(1) << 59, std::uint64_t(1) << 60);
+    assert(is_prime(p));
+    assert(p >= std::uint64_t(1) << 59 && p <= std::uint64_t(1) << 60);
+  }
+  // 23 and 29 equally likely.
+  int count23 = 0;
+  for (int i = 0; i < 2000; ++i) {
+    const std::uint64_t p = random.prime(20, 30);
+    assert(p == 23 || p == 29);
+    count23 += p == 23;
+  }
+  assert(std::abs(count23 - 1000) < 150);
+  bool thrown = false;
+  try {
+    random.prime(24, 28);
+  } catch (const std::invalid_argument &) {
+    thrown = true;
+  }
+  assert(thrown);
+}
+
+void test_coprime() {
+  Random random("foo", 123);
+  for (int i = 0; i < 1000; ++i) {
+    const auto [a, b] = random.coprime_pair(1000000, 2000000);
+    assert(std::gcd(a, b) == 1u);
+    const std::vector<std::uint64_t> t = random.coprime_tuple(3, 6, 20);
+    assert(std::gcd(std::gcd(t[0], t[1]), t[2]) == 1u);
+  }
+  // (2, 3) and (3, 2) equally likely; (2, 2) and (3, 3) impossible.
+  int count23 = 0;
+  for (int i = 0; i < 2000; ++i) {
+    const auto [a, b] = random.coprime_pair(2, 3);
+    assert(a != b);
+    count23 += a == 2;
+  }
+  assert(std::abs(count23 - 1000) < 150);
+  assert(random.coprime_tuple(1, 0, 1000000000000) == std::vector<std::uint64_t>{1});
+}
+
+void test_uniform_int128() {
+  Random random("foo", 123);
+  using u128 = unsigned __int128;
+  const u128 big = u128(3) << 100;
+  for (int i = 0; i < 1000; ++i) {
+    const u128 x = random.uniform_uint128(big, big + (u128(1) << 70));
+    assert(x >= big && x <= big + (u128(1) << 70));
+    const __int128 y = random.uniform_int128(-__int128(big), -__int128(big) + 10);
+    assert(y >= -__int128(big) && y <= -__int128(big) + 10);
+  }
+  // Top bit set about half the time over the full range.
+  int count_top = 0;
+  for (int i = 0; i < 2000; ++i) {
+    count_top += random.uniform_uint128(0, ~u128(0)) >> 127 != 0;
+  }
+  assert(std::abs(count_top - 1000) < 150);
+  // Three values just above 2^64 equally likely.
+  const u128 base = u128(1) << 64;
+  int counts[3] = {};
+  for (int i = 0; i < 3000; ++i) {
+    ++counts[static_cast<int>(random.uniform_uint128(base, base + 2) - base)];
+  }
+  for (const int count : counts) {
+    assert(std::abs(count - 1000) < 150);
+  }
+}
+
+void test_uniform_decimal() {
+  Random random("foo", 123);
+  // 95..123 equally likely.
+  std::map<std::string, int> counts;
+  for (int i = 0; i < 29000; ++i) {
+    ++counts[random.uniform_decimal("95", "123")];
+  }
+  assert(counts.size() == 29u);
+  for (int x = 95; x <= 123; ++x) {
+    assert(std::abs(counts[std::to_string(x)] - 1000) < 150);
+  }
+  assert(random.uniform_decimal("0", "0") == "0");
+  assert(random.uniform_decimal("42", "42") == "42");
+
+  const std::string min = "1" + std::string(999, '0');
+  const std::string max = "1" + std::string(1000, '0');
+  for (int i = 0; i < 100; ++i) {
+    const std::string x = random.uniform_decimal(min, max);
+    assert(x == max || (x.size() == 1000u && x >= min));
+    assert(x.find_first_not_of("0123456789") == std::string::npos);
+  }
+  // Huge range, tiny difference: 10^1000 - 1 or 10^1000.
+  const std::string nines(1000, '9');
+  int count_max = 0;
+  for (int i = 0; i < 2000; ++i) {
+    const std::string x = random.uniform_decimal(nines, max);
+    assert(x == nines || x == max);
+    count_max += x == max;
+  }
+  assert(std::abs(count_max - 1000) < 150);
+
+  for (const auto &[a, b] : {std::pair<const char *, const char *>{"5", "4"},
+                             {"10", "9"}, {"01", "5"}, {"", "5"}, {"1", "2x"}}) {
+    bool thrown = false;
+    try {
+      random.uniform_decimal(a, b);
+    } catch (const std::invalid_argument &) {
+      thrown = true;
+    }
+    assert(thrown);
+  }
+}
+
 int main() {
     test_chacha();
-    test_uniform_int();
+    test_chacha_blocks();
+    test_bits_v1();
+    test_bits_v2();
+    test_uniform_int(Random::UniformMethod::buffered);
+    test_uniform_int(Random::UniformMethod::multiply_shift);
+    test_uniform_ints();
+    test_uniform_int128();
+    test_uniform_decimal();
+    test_uniform_int_distribution();
+    test_uniform_real();
+    test_fill_string();
+    test_balanced_brackets();
+    test_distinct_strings();
+    test_portable_math();
+    test_normal();
+    test_exponential();
+    test_real_golden_values();
+    test_discrete_distribution();
+    test_binomial();
+    test_poisson();
+    test_geometric();
     test_shuffle();
+    test_parallel_shuffle();
+    test_constrained_permutations();
+    test_hash_set();
+    test_sample_distinct();
+    test_sorted_sample();
+    test_composition();
+    test_integer_partition();
+    test_is_prime();
+    test_prime();
+    test_coprime();
     std::cout << "OK\n";
 }
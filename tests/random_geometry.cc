@@ -0,0 +1,87 @@
+#include "random_geometry.h"
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+__int128 cross(const Point &a, const Point &b, const Point &c) {
+  return static_cast<__int128>(b.x - a.x) * (c.y - a.y) -
+         static_cast<__int128>(b.y - a.y) * (c.x - a.x);
+}
+
+void check_in_box(const std::vector<Point> &points,
+                  std::int64_t xmin, std::int64_t xmax, std::int64_t ymin, std::int64_t ymax) {
+  for (const Point &p : points) {
+    assert(p.x >= xmin && p.x <= xmax && p.y >= ymin && p.y <= ymax);
+  }
+}
+
+void check_distinct(const std::vector<Point> &points) {
+  std::vector<std::pair<std::int64_t, std::int64_t>> pairs;
+  for (const Point &p : points) pairs.emplace_back(p.x, p.y);
+  std::sort(pairs.begin(), pairs.end());
+  assert(std::adjacent_find(pairs.begin(), pairs.end()) == pairs.end());
+}
+
+void test_distinct_points() {
+  Random random("foo", 123);
+  const std::int64_t big = 1000000000;
+  std::vector<Point> points = distinct_points(random, 100000, -big, big, -big, big);
+  assert(points.size() == 100000u);
+  check_in_box(points, -big, big, -big, big);
+  check_distinct(points);
+
+  // The whole box.
+  points = distinct_points(random, 12, 5, 7, -1, 2);
+  check_in_box(points, 5, 7, -1, 2);
+  check_distinct(points);
+}
+
+void test_general_position_points() {
+  Random random("foo", 123);
+  const std::vector<Point> points = general_position_points(random, 300, 0, 1000, -500, 2000);
+  assert(points.size() == 300u);
+  check_in_box(points, 0, 1000, -500, 2000);
+  for (size_t i = 0; i < points.size(); ++i) {
+    for (size_t j = i + 1; j < points.size(); ++j) {
+      for (size_t k = j + 1; k < points.size(); ++k) {
+        assert(cross(points[i], points[j], points[k]) != 0);
+      }
+    }
+  }
+  // Largest prime <= 10 is 7.
+  assert(general_position_points(random, 7, 0, 9, 0, 100).size() == 7u);
+}
+
+void test_convex_polygon() {
+  Random random("foo", 123);
+  const std::int64_t big = 1000000000;
+  for (const size_t n : {3u, 10u, 100000u}) {
+    const std::vector<Point> polygon = convex_polygon(random, n, -big, big, 0, big);
+    assert(polygon.size() == n);
+    check_in_box(polygon, -big, big, 0, big);
+    for (size_t i = 0; i < n; ++i) {
+      assert(cross(polygon[i], polygon[(i + 1) % n], polygon[(i + 2) % n]) > 0);
+    }
+    // Turns once around: exactly one vertex is lowest-then-leftmost.
+    const auto before = [](const Point &a, const Point &b) {
+      return a.y != b.y ? a.y < b.y : a.x < b.x;
+    };
+    int num_local_minima = 0;
+    for (size_t i = 0; i < n; ++i) {
+      num_local_minima += before(polygon[i], polygon[(i + n - 1) % n]) &&
+                          before(polygon[i], polygon[(i + 1) % n]);
+    }
+    assert(num_local_minima == 1);
+  }
+  // Small box.
+  assert(convex_polygon(random, 8, 0, 20, 0, 20).size() == 8u);
+}
+
+int main() {
+  test_distinct_points();
+  test_general_position_points();
+  test_convex_polygon();
+  std::cout << "OK\n";
+}
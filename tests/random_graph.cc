@@ -0,0 +1,243 @@
+#include "random_graph.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+// Checks that there are no self-loops or duplicate edges.
+void check_simple(const int n, const std::vector<Edge> &edges, const bool directed) {
+  std::vector<std::pair<int, int>> pairs;
+  for (const Edge &edge : edges) {
+    assert(edge.u >= 0 && edge.u < n && edge.v >= 0 && edge.v < n);
+    assert(edge.u != edge.v);
+    pairs.emplace_back(edge.u, edge.v);
+    if (!directed && edge.u > edge.v) std::swap(pairs.back().first, pairs.back().second);
+  }
+  std::sort(pairs.begin(), pairs.end());
+  assert(std::adjacent_find(pairs.begin(), pairs.end()) == pairs.end());
+}
+
+void test_edge_from_index() {
+  for (const bool directed : {false, true}) {
+    const int n = 50;
+    std::vector<Edge> edges;
+    for (uint64_t i = 0; i < num_possible_edges(n, directed); ++i) {
+      edges.push_back(edge_from_index(i, n, directed));
+    }
+    assert(edges.size() == (directed ? 50u * 49u : 50u * 49u / 2u));
+    check_simple(n, edges, directed);
+  }
+  const Edge edge = edge_from_index(num_possible_edges(2000000000, false) - 1u, 2000000000, false);
+  assert(edge.u == 1999999999 && edge.v == 1999999998);
+}
+
+void test_gnm_graph() {
+  Random random("foo", 123);
+  for (const bool directed : {false, true}) {
+    const std::vector<Edge> edges = gnm_graph(random, 1000, 100000, directed);
+    assert(edges.size() == 100000u);
+    check_simple(1000, edges, directed);
+  }
+  assert(gnm_graph(random, 5, 10).size() == 10u);
+
+  // Each edge of the complete graph on 4 vertices equally likely.
+  std::vector<int> counts(6);
+  for (int trial = 0; trial < 6000; ++trial) {
+    const std::vector<Edge> edges = gnm_graph(random, 4, 1);
+    const auto [u, v] = std::minmax(edges[0].u, edges[0].v);
+    ++counts[v * (v - 1) / 2 + u];
+  }
+  for (const int count : counts) {
+    assert(count > 850 && count < 1150);
+  }
+}
+
+void test_gnp_graph() {
+  Random random("foo", 123);
+  for (const bool directed : {false, true}) {
+    const int n = 2000;
+    const double p = 0.01;
+    const std::vector<Edge> edges = gnp_graph(random, n, p, directed);
+    check_simple(n, edges, directed);
+    const double mean = num_possible_edges(n, directed) * p;
+    assert(std::abs(edges.size() - mean) < 5 * std::sqrt(mean));
+  }
+  assert(gnp_graph(random, 10, 0.0).empty());
+  assert(gnp_graph(random, 10, 1.0).size() == 45u);
+}
+
+void test_connected_graph() {
+  Random random("foo", 123);
+  for (const uint64_t m : {999u, 1000u, 5000u, 499500u}) {
+    const int n = 1000;
+    const std::vector<Edge> edges = connected_graph(random, n, m);
+    assert(edges.size() == m);
+    check_simple(n, edges, false);
+    std::vector<int> parent(n);
+    for (int i = 0; i < n; ++i) parent[i] = i;
+    const auto find = [&](int x) {
+      while (parent[x] != x) x = parent[x] = parent[parent[x]];
+      return x;
+    };
+    int num_components = n;
+    for (const Edge &edge : edges) {
+      const int a = find(edge.u);
+      const int b = find(edge.v);
+      if (a != b) {
+        parent[a] = b;
+        --num_components;
+      }
+    }
+    assert(num_components == 1);
+  }
+}
+
+void test_dag() {
+  Random random("foo", 123);
+  const int n = 1000;
+  const std::vector<Edge> edges = dag(random, n, 20000);
+  assert(edges.size() == 20000u);
+  check_simple(n, edges, true);
+  // Kahn's algorithm removes every vertex.
+  std::vector<std::vector<int>> out(n);
+  std::vector<int> in_degree(n);
+  for (const Edge &edge : edges) {
+    out[edge.u].push_back(edge.v);
+    ++in_degree[edge.v];
+  }
+  std::vector<int> ready;
+  for (int v = 0; v < n; ++v) if (in_degree[v] == 0) ready.push_back(v);
+  int num_removed = 0;
+  while (!ready.empty()) {
+    const int v = ready.back();
+    ready.pop_back();
+    ++num_removed;
+    for (const int w : out[v]) if (--in_degree[w] == 0) ready.push_back(w);
+  }
+  assert(num_removed == n);
+}
+
+void test_bipartite_graph() {
+  Random random("foo", 123);
+  const std::vector<Edge> edges = bipartite_graph(random, 100, 200, 5000);
+  assert(edges.size() == 5000u);
+  check_simple(300, edges, true);
+  for (const Edge &edge : edges) {
+    assert(edge.u < 100 && edge.v >= 100);
+  }
+  assert(bipartite_graph(random, 3, 4, 12).size() == 12u);
+}
+
+void test_adjacency_graph() {
+  const AdjacencyGraph graph = adjacency_graph(4, {{0, 1}, {2, 1}, {1, 3}});
+  assert(graph.num_vertices() == 4);
+  assert((graph.offsets == std::vector<int>{0, 1, 4, 5, 6}));
+  assert((graph.targets == std::vector<int>{1, 0, 2, 3, 1, 1}));
+  const AdjacencyGraph directed = adjacency_graph(4, {{0, 1}, {2, 1}, {1, 3}}, true);
+  assert((directed.offsets == std::vector<int>{0, 1, 2, 3, 3}));
+  assert((directed.targets == std::vector<int>{1, 3, 1}));
+}
+
+void test_uniform_spanning_tree() {
+  Random random("foo", 123);
+  const AdjacencyGraph grid = adjacency_graph(300 * 200, grid_graph(300, 200));
+  const std::vector<Edge> tree = uniform_spanning_tree(random, grid);
+  assert(tree.size() == 300u * 200u - 1u);
+  // Connected, so it is a tree.
+  uniform_spanning_tree(random, adjacency_graph(300 * 200, tree));
+  for (const Edge &edge : tree) {
+    const int d = std::abs(edge.u - edge.v);
+    assert(d == 1 || d == 200);
+  }
+
+  // A 4-cycle with a chord has 8 spanning trees: 4 without the chord and
+  // 4 with it. The chord is in a uniform one with probability 1/2.
+  const AdjacencyGraph graph = adjacency_graph(4, {{0, 1}, {1, 2}, {2, 3}, {3, 0}, {0, 2}});
+  int num_with_chord = 0;
+  const int num_trials = 10000;
+  for (int trial = 0; trial < num_trials; ++trial) {
+    const std::vector<Edge> edges = uniform_spanning_tree(random, graph);
+    assert(edges.size() == 3u);
+    for (const Edge &edge : edges) {
+      num_with_chord += std::abs(edge.u - edge.v) == 2;
+    }
+  }
+  assert(std::abs(num_with_chord - num_trials / 2) < 250);
+
+  bool thrown = false;
+  try {
+    uniform_spanning_tree(random, adjacency_graph(3, {{0, 1}}));
+  } catch (const std::invalid_argument &) {
+    thrown = true;
+  }
+  assert(thrown);
+}
+
+void check_degrees(const std::vector<int> &degrees, const std::vector<Edge> &edges) {
+  const int n = degrees.size();
+  check_simple(n, edges, false);
+  std::vector<int> actual(n);
+  for (const Edge &edge : edges) {
+    ++actual[edge.u];
+    ++actual[edge.v];
+  }
+  assert(actual == degrees);
+}
+
+void test_configuration_model() {
+  Random random("foo", 123);
+  std::vector<int> degrees(10000);
+  for (int &d : degrees) d = random.uniform_int(1, 3);
+  degrees[0] += (std::accumulate(degrees.begin(), degrees.end(), 0) % 2);
+  check_degrees(degrees, configuration_model(random, degrees));
+
+  // The 3 perfect matchings on 4 vertices are equally likely.
+  std::vector<int> counts(3);
+  for (int trial = 0; trial < 3000; ++trial) {
+    const std::vector<Edge> edges = configuration_model(random, {1, 1, 1, 1});
+    for (const Edge &edge : edges) {
+      if (edge.u == 0 || edge.v == 0) ++counts[edge.u + edge.v - 1];
+    }
+  }
+  for (const int count : counts) {
+    assert(count > 850 && count < 1150);
+  }
+}
+
+void test_degree_sequence_graph() {
+  Random random("foo", 123);
+  std::vector<int> degrees(10000);
+  for (int &d : degrees) d = random.uniform_int(1, 100);
+  degrees[0] += (std::accumulate(degrees.begin(), degrees.end(), 0) % 2);
+  const std::vector<Edge> edges = degree_sequence_graph(random, degrees, 1000000);
+  check_degrees(degrees, edges);
+
+  // Complete graph and a star.
+  check_degrees({3, 3, 3, 3}, degree_sequence_graph(random, {3, 3, 3, 3}, 100));
+  check_degrees({4, 1, 1, 1, 1}, degree_sequence_graph(random, {4, 1, 1, 1, 1}, 100));
+
+  bool thrown = false;
+  try {
+    degree_sequence_graph(random, {3, 3, 1, 1}, 100);
+  } catch (const std::invalid_argument &) {
+    thrown = true;
+  }
+  assert(thrown);
+}
+
+int main() {
+  test_edge_from_index();
+  test_gnm_graph();
+  test_gnp_graph();
+  test_connected_graph();
+  test_dag();
+  test_bipartite_graph();
+  test_adjacency_graph();
+  test_uniform_spanning_tree();
+  test_configuration_model();
+  test_degree_sequence_graph();
+  std::cout << "OK\n";
+}
@@ -0,0 +1,135 @@
+#include "random_matrix.h"
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Gaussian elimination mod p.
+std::size_t rank_of(Matrix m, const std::uint32_t p) {
+  const auto power = [p](std::uint64_t x, std::uint32_t e) {
+    std::uint64_t result = 1;
+    for (; e != 0u; e >>= 1, x = x * x % p) {
+      if (e & 1u) result = result * x % p;
+    }
+    return result;
+  };
+  std::size_t rank = 0;
+  for (std::size_t col = 0; col < m.cols && rank < m.rows; ++col) {
+    std::size_t pivot = rank;
+    while (pivot < m.rows && m[pivot][col] == 0u) ++pivot;
+    if (pivot == m.rows) continue;
+    for (std::size_t j = 0; j < m.cols; ++j) std::swap(m[pivot][j], m[rank][j]);
+    const std::uint64_t inverse = power(m[rank][col], p - 2u);
+    for (std::size_t i = rank + 1; i < m.rows; ++i) {
+      const std::uint64_t factor = m[i][col] * inverse % p;
+      for (std::size_t j = col; j < m.cols; ++j) {
+        m[i][j] = (m[i][j] + (p - factor) * m[rank][j]) % p;
+      }
+    }
+    ++rank;
+  }
+  return rank;
+}
+
+void test_multiply() {
+  Random random("foo", 123);
+  for (const std::uint32_t p : {2u, 998244353u, 2147483647u}) {
+    const Matrix a = random_matrix(random, 70, 600, p);
+    Matrix b = random_matrix(random, 600, 530, p);
+    // Zeros and a triangular part are skipped.
+    for (std::size_t k = 0; k < b.rows; ++k) {
+      for (std::size_t j = 0; j < k && j < b.cols; ++j) b[k][j] = 0;
+    }
+    const Matrix c = multiply(a, b, p, 3);
+    assert(c.rows == 70u && c.cols == 530u);
+    for (std::size_t i = 0; i < c.rows; ++i) {
+      for (std::size_t j = 0; j < c.cols; ++j) {
+        std::uint64_t sum = 0;
+        for (std::size_t k = 0; k < a.cols; ++k) {
+          sum = (sum + std::uint64_t(a[i][k]) * b[k][j]) % p;
+        }
+        assert(c[i][j] == sum);
+      }
+    }
+  }
+  bool thrown = false;
+  try {
+    multiply(Matrix(2, 3), Matrix(2, 3), 7);
+  } catch (const std::invalid_argument &) {
+    thrown = true;
+  }
+  assert(thrown);
+}
+
+void test_invertible_matrix() {
+  Random random("foo", 123);
+  for (const std::uint32_t p : {2u, 3u, 1000000007u}) {
+    const Matrix m = invertible_matrix(random, 100, p);
+    assert(m.rows == 100u && m.cols == 100u);
+    for (const std::uint32_t x : m.entries) assert(x < p);
+    assert(rank_of(m, p) == 100u);
+  }
+  assert(invertible_matrix(random, 0, 5).entries.empty());
+
+  // All 168 invertible 3x3 matrices mod 2 equally likely.
+  std::map<std::vector<std::uint32_t>, int> counts;
+  for (int i = 0; i < 168 * 200; ++i) {
+    const Matrix m = invertible_matrix(random, 3, 2);
+    assert(rank_of(m, 2) == 3u);
+    ++counts[m.entries];
+  }
+  assert(counts.size() == 168u);
+  for (const auto &entry : counts) {
+    assert(std::abs(entry.second - 200) < 70);
+  }
+
+  bool thrown = false;
+  try {
+    invertible_matrix(random, 3, 4);
+  } catch (const std::invalid_argument &) {
+    thrown = true;
+  }
+  assert(thrown);
+}
+
+void test_matrix_of_rank() {
+  Random random("foo", 123);
+  for (const std::uint32_t p : {2u, 998244353u}) {
+    for (const std::size_t rank : {0u, 1u, 17u, 40u}) {
+      const Matrix m = matrix_of_rank(random, 40, 90, rank, p);
+      assert(m.rows == 40u && m.cols == 90u);
+      assert(rank_of(m, p) == rank);
+    }
+  }
+
+  // The 21 rank 1 2x3 matrices mod 2 equally likely.
+  std::map<std::vector<std::uint32_t>, int> counts;
+  for (int i = 0; i < 21 * 200; ++i) {
+    const Matrix m = matrix_of_rank(random, 2, 3, 1, 2);
+    assert(rank_of(m, 2) == 1u);
+    ++counts[m.entries];
+  }
+  assert(counts.size() == 21u);
+  for (const auto &entry : counts) {
+    assert(std::abs(entry.second - 200) < 70);
+  }
+
+  bool thrown = false;
+  try {
+    matrix_of_rank(random, 2, 3, 3, 7);
+  } catch (const std::invalid_argument &) {
+    thrown = true;
+  }
+  assert(thrown);
+}
+
+int main() {
+  test_multiply();
+  test_invertible_matrix();
+  test_matrix_of_rank();
+  std::cout << "OK\n";
+}
@@ -0,0 +1,103 @@
+#include "random_tree.h"
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <map>
+#include <vector>
+
+// Checks that edges form a tree on n vertices. Returns the degrees.
+std::vector<int> check_tree(const int n, const std::vector<Edge> &edges) {
+  assert(int(edges.size()) == std::max(n - 1, 0));
+  std::vector<int> parent(n);
+  for (int i = 0; i < n; ++i) parent[i] = i;
+  const auto find = [&](int x) {
+    while (parent[x] != x) x = parent[x] = parent[parent[x]];
+    return x;
+  };
+  std::vector<int> degree(n);
+  for (const Edge &edge : edges) {
+    assert(edge.u >= 0 && edge.u < n && edge.v >= 0 && edge.v < n);
+    const int a = find(edge.u);
+    const int b = find(edge.v);
+    assert(a != b);
+    parent[a] = b;
+    ++degree[edge.u];
+    ++degree[edge.v];
+  }
+  return degree;
+}
+
+void test_prufer_decode() {
+  const std::vector<Edge> edges = prufer_decode({3, 3, 3, 4});
+  const std::vector<std::pair<int, int>> expected = {{0, 3}, {1, 3}, {2, 3}, {3, 4}, {4, 5}};
+  assert(edges.size() == expected.size());
+  for (size_t i = 0; i < edges.size(); ++i) {
+    assert(edges[i].u == expected[i].first && edges[i].v == expected[i].second);
+  }
+}
+
+void test_random_tree() {
+  Random random("foo", 123);
+  for (int n = 0; n <= 3; ++n) check_tree(n, random_tree(random, n));
+  check_tree(100000, random_tree(random, 100000));
+
+  // All 16 labeled trees on 4 vertices equally likely.
+  std::map<std::vector<std::pair<int, int>>, int> counts;
+  const int num_trials = 16000;
+  for (int trial = 0; trial < num_trials; ++trial) {
+    std::vector<std::pair<int, int>> tree;
+    for (const Edge &edge : random_tree(random, 4)) {
+      tree.push_back(std::minmax(edge.u, edge.v));
+    }
+    std::sort(tree.begin(), tree.end());
+    ++counts[tree];
+  }
+  assert(counts.size() == 16);
+  for (const auto &[tree, count] : counts) {
+    assert(count > 850 && count < 1150);
+  }
+}
+
+void test_bounded_tree() {
+  Random random("foo", 123);
+  const int n = 100000;
+  std::vector<Edge> edges = bounded_tree(random, n, 3, 20);
+  const std::vector<int> degree = check_tree(n, edges);
+  assert(*std::max_element(degree.begin(), degree.end()) <= 3);
+  std::vector<int> depth(n);
+  for (const Edge &edge : edges) {
+    assert(edge.u < edge.v);
+    depth[edge.v] = depth[edge.u] + 1;
+    assert(depth[edge.v] <= 20);
+  }
+
+  // A full binary tree of depth 2 is the largest possible.
+  check_tree(7, bounded_tree(random, 7, 3, 2));
+  bool thrown = false;
+  try {
+    bounded_tree(random, 11, 3, 2);
+  } catch (const std::invalid_argument &) {
+    thrown = true;
+  }
+  assert(thrown);
+}
+
+void test_caterpillar() {
+  Random random("foo", 123);
+  const int n = 1000;
+  std::vector<Edge> edges = caterpillar(random, n, 10);
+  check_tree(n, edges);
+  for (const Edge &edge : edges) {
+    assert(edge.u < 10);
+  }
+  relabel(random, n, edges);
+  check_tree(n, edges);
+}
+
+int main() {
+  test_prufer_decode();
+  test_random_tree();
+  test_bounded_tree();
+  test_caterpillar();
+  std::cout << "OK\n";
+}